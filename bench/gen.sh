@@ -0,0 +1,69 @@
+#!/bin/sh
+#
+# gen.sh -- generate a synthetic suite for benchmarking unittest.h itself
+#
+# usage: gen.sh SCENARIO TESTS GROUP_SIZE OUTDIR
+#
+#   flat    independent tests with one assertion each (discovery, sorting, dispatch)
+#   chain   every test depends on the previous one in its group, and every group
+#           on the previous group (toposort, scheduler with deep dependency chains)
+#   assert  tests running 100 passing assertions each (per-ut_assert cost)
+#   fail    tests running 100 failing assertions each (printer throughput)
+#
+# writes one file per group (g<k>.c) and main.c into OUTDIR.
+#
+
+set -e
+
+if [ $# -ne 4 ]; then
+	echo "usage: $0 SCENARIO TESTS GROUP_SIZE OUTDIR" >&2
+	exit 1
+fi
+
+scenario=$1
+tests=$2
+group_size=$3
+outdir=$4
+
+case "$scenario" in
+	flat|chain|assert|fail) ;;
+	*) echo "$0: unknown scenario \`$scenario'" >&2; exit 1 ;;
+esac
+
+mkdir -p "$outdir"
+rm -f "$outdir"/g*.c
+
+printf '#include "unittest.h"\n\nint main(int argc, char *argv[])\n{\n\treturn(unittest_main(argc, argv));\n}\n' > "$outdir/main.c"
+
+awk -v scenario="$scenario" -v tests="$tests" -v group_size="$group_size" -v outdir="$outdir" '
+BEGIN {
+	groups = int((tests + group_size - 1) / group_size);
+	for(g = 0; g < groups; g++) {
+		file = sprintf("%s/g%d.c", outdir, g);
+		printf("#define UNITTEST_UNIQUE_ID %d\n#include \"unittest.h\"\n\n", g + 1) > file;
+		if(scenario == "chain" && g > 0) {
+			printf("unittest_config(.name = \"g%d\", .depends_on = { \"g%d\" });\n\n", g, g - 1) > file;
+		} else {
+			printf("unittest_config(.name = \"g%d\");\n\n", g) > file;
+		}
+
+		lo = g * group_size;
+		hi = lo + group_size < tests ? lo + group_size : tests;
+		for(i = lo; i < hi; i++) {
+			if(scenario == "chain" && i > lo) {
+				printf("unittest(.name = \"t%d\", .depends_on = { \"t%d\" }) {\n", i, i - 1) > file;
+			} else {
+				printf("unittest(.name = \"t%d\") {\n", i) > file;
+			}
+			if(scenario == "assert") {
+				printf("\tfor(volatile int i = 0; i < 100; i++) { ut_assert(i >= 0); }\n") > file;
+			} else if(scenario == "fail") {
+				printf("\tfor(volatile int i = 0; i < 100; i++) { ut_assert(i < 0, \"i(%%d)\", i); }\n") > file;
+			} else {
+				printf("\tut_assert(%d == %d);\n", i, i) > file;
+			}
+			printf("}\n\n") > file;
+		}
+		close(file);
+	}
+}'
@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+# run.sh -- benchmark unittest.h itself on generated suites
+#
+# environment:
+#   CC, CFLAGS      compiler and flags (gcc, -O3 -std=c11 -pthread)
+#   BENCH_SIZES     test counts (1000 10000 100000)
+#   BENCH_THREADS   -n values (1 2 4 8)
+#   BENCH_GROUP     tests per group (1000)
+#   BENCH_DIR       working directory (bench/out)
+#
+# prints one json object per run on stdout; the runner's own timings are in
+# "profile" (see --profile), and the derived costs are:
+#   ns_per_test     wall time of the run phase per executed test
+#   ns_per_assert   cpu time in the test bodies per assertion (assert, fail), less
+#                   the per-test cpu time of the flat suite of the same size and -n
+#                   (the clock reads around each body and its one assertion)
+#
+
+set -e
+
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:-"-O3 -std=c11 -pthread"}
+BENCH_SIZES=${BENCH_SIZES:-"1000 10000 100000"}
+BENCH_THREADS=${BENCH_THREADS:-"1 2 4 8"}
+BENCH_GROUP=${BENCH_GROUP:-1000}
+BENCH_DIR=${BENCH_DIR:-bench/out}
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+jobs=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 4)
+
+# extract a number from the profile
+field() {
+	sed -n "s/.*\"$2\": \([0-9]*\).*/\1/p" "$1"
+}
+
+for size in $BENCH_SIZES; do
+	for scenario in flat chain assert fail; do
+		# failing assertions print a message each; keep the output size moderate
+		tests=$size
+		if [ "$scenario" = fail ]; then tests=$(( (size + 99) / 100 )); fi
+
+		dir=$BENCH_DIR/$scenario-$size
+		"$root/bench/gen.sh" "$scenario" "$tests" "$BENCH_GROUP" "$dir"
+		# unittest_main is static and unused in the files without main
+		ls "$dir"/*.c | xargs -P "$jobs" -I{} sh -c "$CC $CFLAGS -Wno-unused-function -I'$root' -c {} -o {}.o"
+		$CC $CFLAGS -o "$dir/bench" "$dir"/*.o
+
+		for threads in $BENCH_THREADS; do
+			"$dir/bench" -n "$threads" --profile "$dir/profile.json" >/dev/null 2>&1
+			p=$dir/profile.json
+
+			executed=$(field "$p" executed)
+			asserts=$(( $(field "$p" succeeded) + $(field "$p" failed) ))
+			ns_per_test=$(( $(field "$p" run) / (executed > 0 ? executed : 1) ))
+			cpu=$(field "$p" test_cpu_ns)
+			ns_per_assert=null
+			case "$scenario" in
+				flat) eval "flat_cpu_$threads=$(( cpu / (executed > 0 ? executed : 1) ))" ;;
+				assert|fail)
+					base=$(eval echo "\${flat_cpu_$threads:-0}")
+					body=$(( cpu - executed * base ))
+					ns_per_assert=$(( (body > 0 ? body : 0) / (asserts > 0 ? asserts : 1) )) ;;
+			esac
+
+			printf '{"scenario": "%s", "size": %s, "ns_per_test": %s, "ns_per_assert": %s, "profile": %s}\n' \
+				"$scenario" "$tests" "$ns_per_test" "$ns_per_assert" "$(cat "$p")"
+		done
+	done
+done
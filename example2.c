@@ -39,7 +39,7 @@ unittest(
 	.depends_on = {"second test"}
 ) {
 	char const *hello = "hello world";
-	ut_assert(hello == NULL, "%s, %s", hello, ut_dump(hello, 16));
+	ut_assert(hello == NULL, "%s, %s", hello, ut_dump(hello, strlen(hello) + 1));
 }
 
 /*
@@ -24,11 +24,26 @@
 #define UNITTEST_ALIAS_MAIN		0
 #endif
 
+/* register tests in dedicated linker sections instead of discovering them from the symbol table */
+#ifndef UNITTEST_USE_SECTION
+#define UNITTEST_USE_SECTION	0
+#endif
+
+/* assertion tier compiled in: 0 for ut_assert only, 1 adds ut_assert_cheap, 2 adds ut_assert_expensive */
+#ifndef UT_ASSERT_LEVEL
+#define UT_ASSERT_LEVEL			2
+#endif
+
 /* for compatibility with -std=c99 (2016/4/26 by Hajime Suzuki) */
 #if defined(__linux__) && !defined(_POSIX_C_SOURCE)
 #  define _POSIX_C_SOURCE		200112L
 #endif
 
+/* MAP_ANONYMOUS and MAP_NORESERVE */
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#  define _DEFAULT_SOURCE
+#endif
+
 #if defined(__darwin__) && !defined(_BSD_SOURCE)
 #  define _BSD_SOURCE
 #endif
@@ -37,18 +52,76 @@
 
 #include <alloca.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stddef.h>				/* offsetof */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>			/* dev_t, ino_t */
+#include <sys/wait.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#if defined(__ELF__)
+#include <elf.h>
+#endif
+
+/*
+ * the feature-test macros above are ignored when a system header was included before
+ * this file (e.g. <stdio.h> first under -std=c11); fall back to what is left then.
+ */
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#  define MAP_ANONYMOUS			MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#  define MAP_NORESERVE			0
+#endif
+#if !defined(MAP_ANONYMOUS) && !defined(__linux__)
+#  error "unittest.h: anonymous mmap is not declared; include unittest.h before any system header or build with -D_DEFAULT_SOURCE."
+#endif
+/* SA_ONSTACK, SA_NODEFER and stack_t are XSI; --catch-signals is compiled out without them */
+#if defined(SA_ONSTACK) && defined(SA_NODEFER) && defined(SS_DISABLE)
+#  define UT_HAVE_CATCH			1
+#else
+#  define UT_HAVE_CATCH			0
+#endif
 
-#ifdef _OPENMP
-#include <omp.h>
+/**
+ * @fn ut_mmap_anon
+ * @brief anonymous read-write mapping; /dev/zero stands in when MAP_ANONYMOUS is not declared
+ */
+static inline
+void *ut_mmap_anon(
+	size_t size,
+	int flags)
+{
+#if defined(MAP_ANONYMOUS)
+	return(mmap(NULL, size, PROT_READ | PROT_WRITE, flags | MAP_ANONYMOUS, -1, 0));
+#else
+	int const fd = open("/dev/zero", O_RDWR);
+	if(fd < 0) { return(MAP_FAILED); }
+	void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+	close(fd);
+	return(p);
 #endif
+}
 
 #ifndef UNITTEST_UNIQUE_ID
 #define UNITTEST_UNIQUE_ID		0
@@ -134,6 +207,169 @@
  */
 int main(int argc, char *argv[]);
 
+#ifndef UNITTEST_ARENA_CHUNK
+#define UNITTEST_ARENA_CHUNK		( 2 * 1024 * 1024 )		/* size of the first chunk */
+#endif
+#ifndef UNITTEST_ARENA_RETAIN
+#define UNITTEST_ARENA_RETAIN		( 64 * 1024 * 1024 )	/* largest chunk kept across tests */
+#endif
+#ifndef UNITTEST_ARENA_HUGEPAGE
+#define UNITTEST_ARENA_HUGEPAGE		0						/* align chunks to 2MB and madvise(MADV_HUGEPAGE) */
+#endif
+#ifndef UNITTEST_ARENA_POISON
+#  ifdef NDEBUG
+#    define UNITTEST_ARENA_POISON	0
+#  else
+#    define UNITTEST_ARENA_POISON	1						/* fill allocated bytes with 0xa5 and released ones with 0xdd */
+#  endif
+#endif
+
+#define UT_ARENA_ALIGN				( 16 )
+#define UT_ARENA_HUGE_SIZE			( 2 * 1024 * 1024 )
+
+/**
+ * @struct ut_arena_s
+ * @brief per-thread bump allocator for test bodies (ut_alloc / ut_alloc_aligned).
+ * chunks are mapped directly and reset (not freed) between tests; only the last,
+ * largest, chunk is kept for the next test unless it exceeds UNITTEST_ARENA_RETAIN.
+ */
+struct ut_arena_chunk_s {
+	struct ut_arena_chunk_s *next;	/* older chunk */
+	size_t size;					/* including this header */
+};
+
+struct ut_arena_s {
+	struct ut_arena_chunk_s *head;
+	uint8_t *ptr, *end;				/* free space of the head chunk */
+	int no_poison;					/* set while benchmarking, so that the batches do not time the fills */
+};
+
+/**
+ * @fn ut_arena_map_chunk
+ */
+static inline
+struct ut_arena_chunk_s *ut_arena_map_chunk(
+	size_t size)
+{
+#if UNITTEST_ARENA_HUGEPAGE != 0 && defined(MADV_HUGEPAGE)
+	/* over-map and trim to a 2MB boundary so that the chunk can be backed by huge pages */
+	uint8_t *base = (uint8_t *)ut_mmap_anon(size + UT_ARENA_HUGE_SIZE, MAP_PRIVATE);
+	if((void *)base == MAP_FAILED) { return(NULL); }
+
+	uint8_t *p = (uint8_t *)(((uintptr_t)base + UT_ARENA_HUGE_SIZE - 1) & ~(uintptr_t)(UT_ARENA_HUGE_SIZE - 1));
+	if(p > base) { munmap(base, p - base); }
+	munmap(p + size, base + UT_ARENA_HUGE_SIZE - p);
+	madvise(p, size, MADV_HUGEPAGE);
+	return((struct ut_arena_chunk_s *)p);
+#else
+	void *p = ut_mmap_anon(size, MAP_PRIVATE);
+	return(p == MAP_FAILED ? NULL : (struct ut_arena_chunk_s *)p);
+#endif
+}
+
+/**
+ * @fn ut_arena_grow
+ * @brief push a chunk large enough for the request; returns the aligned address, 0 on failure
+ */
+static __attribute__(( noinline ))
+uintptr_t ut_arena_grow(
+	struct ut_arena_s *arena,
+	size_t size,
+	size_t align)
+{
+	if(size > SIZE_MAX - sizeof(struct ut_arena_chunk_s) - align) { return(0); }
+	size_t const need = sizeof(struct ut_arena_chunk_s) + size + align;
+	size_t csize = arena->head != NULL ? 2 * arena->head->size : UNITTEST_ARENA_CHUNK;
+	while(csize < need) {
+		if(csize > SIZE_MAX / 2) { return(0); }
+		csize *= 2;
+	}
+
+	struct ut_arena_chunk_s *c = ut_arena_map_chunk(csize);
+	if(c == NULL) { return(0); }
+	*c = (struct ut_arena_chunk_s){ .next = arena->head, .size = csize };
+	arena->head = c;
+	arena->end = (uint8_t *)c + csize;
+	return(((uintptr_t)(c + 1) + align - 1) & ~(uintptr_t)(align - 1));
+}
+
+/**
+ * @fn ut_arena_alloc
+ * @brief align must be a power of two; returns NULL when out of memory
+ */
+static inline
+void *ut_arena_alloc(
+	struct ut_arena_s *arena,
+	size_t size,
+	size_t align)
+{
+	uintptr_t p = ((uintptr_t)arena->ptr + align - 1) & ~(uintptr_t)(align - 1);
+	if(__builtin_expect(arena->head == NULL || p < (uintptr_t)arena->ptr || (uintptr_t)arena->end - p < size || size > PTRDIFF_MAX, 0)) {
+		if(size > PTRDIFF_MAX || (p = ut_arena_grow(arena, size, align)) == 0) { return(NULL); }
+	}
+	arena->ptr = (uint8_t *)(p + size);
+	#if UNITTEST_ARENA_POISON != 0
+		if(arena->no_poison == 0) { memset((void *)p, 0xa5, size); }
+	#endif
+	return((void *)p);
+}
+
+/**
+ * @fn ut_arena_reset
+ * @brief release everything allocated; the head chunk is kept for reuse unless too large
+ */
+static inline
+void ut_arena_reset(
+	struct ut_arena_s *arena)
+{
+	struct ut_arena_chunk_s *keep = arena->head;
+	if(keep == NULL) { return; }
+	if(keep->size > UNITTEST_ARENA_RETAIN) { keep = NULL; }
+
+	#if UNITTEST_ARENA_POISON != 0
+		if(keep != NULL && arena->no_poison == 0) { memset(keep + 1, 0xdd, arena->ptr - (uint8_t *)(keep + 1)); }
+	#endif
+
+	for(struct ut_arena_chunk_s *c = arena->head, *next; c != NULL; c = next) {
+		next = c->next;
+		if(c != keep) { munmap((void *)c, c->size); }
+	}
+	if(keep == NULL) {
+		*arena = (struct ut_arena_s){ .no_poison = arena->no_poison };
+		return;
+	}
+
+	keep->next = NULL;
+	*arena = (struct ut_arena_s){
+		.head = keep,
+		.ptr = (uint8_t *)(keep + 1),
+		.end = (uint8_t *)keep + keep->size,
+		.no_poison = arena->no_poison
+	};
+	return;
+}
+
+static inline
+void ut_arena_destroy(
+	struct ut_arena_s *arena)
+{
+	for(struct ut_arena_chunk_s *c = arena->head, *next; c != NULL; c = next) {
+		next = c->next;
+		munmap((void *)c, c->size);
+	}
+	*arena = (struct ut_arena_s){ 0 };
+	return;
+}
+
+/**
+ * @macro ut_alloc, ut_alloc_aligned
+ *
+ * @brief allocate from the arena of the test; no need to free, the memory is
+ * released when the test returns.
+ */
+#define ut_alloc(size)					ut_arena_alloc(ut_arena, (size), UT_ARENA_ALIGN)
+#define ut_alloc_aligned(size, align)	ut_arena_alloc(ut_arena, (size), (align))
+
 /**
  * @struct ut_result_s
  */
@@ -141,6 +377,18 @@ struct ut_result_s {
 	size_t cnt;
 	size_t succ;
 	size_t fail;
+	uint64_t wall_ns;		/* sum over the tests in the group */
+	uint64_t cpu_ns;
+};
+
+/**
+ * @struct ut_bench_result_s
+ */
+struct ut_bench_result_s {
+	double ns_per_op;		/* median */
+	double mad;				/* median absolute deviation */
+	size_t iterations;		/* per sample */
+	size_t samples;
 };
 
 struct ut_global_config_s;
@@ -163,7 +411,15 @@ struct ut_printer_s {
 		struct ut_global_config_s const *gconf,
 		struct ut_group_config_s const *config,
 		struct ut_result_s const *result,
-		size_t file_cnt);
+		size_t file_cnt,
+		struct ut_s const *test,
+		size_t test_cnt);
+
+	void (*bench)(
+		struct ut_s const *info,
+		struct ut_global_config_s const *gconf,
+		struct ut_group_config_s const *config,
+		struct ut_bench_result_s const *result);
 };
 
 /**
@@ -173,6 +429,39 @@ struct ut_global_config_s {
 	FILE *fp;
 	struct ut_printer_s printer;
 	size_t threads;
+	size_t ordered;			/* flush failure messages in the test order */
+	size_t isolate;			/* run tests in forked worker processes */
+	size_t timeout_ms;		/* default per-test timeout, 0 to disable */
+	size_t catch_signals;	/* recover from faults in the test body in-process */
+	size_t fail_fast;		/* stop after this many failed tests, 0 to disable */
+
+	/* benchmarks */
+	size_t bench;			/* run unittest_bench bodies when nonzero */
+	size_t bench_time_ms;	/* target duration of a sample */
+
+	/* timing report */
+	size_t slowest;			/* length of the slowest test list */
+	double slow_ms;			/* flag tests slower than this (0 to disable) */
+
+	/* sharding */
+	size_t shard_index, shard_count;
+	char const *timing_file;		/* durations used for partitioning */
+	char const *save_timing_file;	/* write durations of this run */
+
+	/* history of the previous runs, used as scheduling priorities */
+	char const *history_file;
+	struct ut_record_s const *history;
+
+	/* incremental run */
+	size_t changed_only;
+	char const *cache_file;		/* NULL for the default (next to the executable) */
+
+	/* timings of the runner itself */
+	char const *profile_file;
+
+	/* golden files of ut_assert_snapshot */
+	char const *snapshot_dir;	/* NULL for UNITTEST_SNAPSHOT_DIR */
+	size_t update_snapshots;
 };
 
 /**
@@ -193,10 +482,18 @@ struct ut_group_config_s {
 	char const *name;
 	char const *depends_on[16];
 
-	/* environment setup and cleanup */
+	/*
+	 * environment setup and cleanup; init is called once, lazily, before the
+	 * first selected test of the group, and clean after the last one. the
+	 * context (gctx) is shared by all the tests in the group, which may run
+	 * concurrently under -n: treat it as read-only or synchronize by yourself.
+	 */
 	void *(*init)(void *params);
 	void (*clean)(void *context);
 	void *params;
+
+	/* default timeout of the tests in the group (0 for the global default) */
+	size_t timeout_ms;
 };
 
 /**
@@ -215,6 +512,7 @@ struct ut_s {
 	void (*fn)(
 		void *ctx,
 		void *gctx,
+		struct ut_arena_s *arena,
 		struct ut_s *info,
 		struct ut_global_config_s const *ut_gconf,
 		struct ut_group_config_s const *config);
@@ -231,6 +529,15 @@ struct ut_s {
 	void *(*init)(void *params);
 	void (*clean)(void *context);
 	void *params;
+
+	/* internal use: 1 when declared with unittest_bench */
+	size_t bench;
+
+	/* timeout (0 to inherit the group or global default) */
+	size_t timeout_ms;
+
+	/* internal use: wall-clock and thread cpu time of the last run */
+	uint64_t wall_ns, cpu_ns;
 };
 
 /* the two structs must be castable */
@@ -265,6 +572,25 @@ ut_static_assert(offsetof(struct ut_group_config_s, params) == offsetof(struct u
 #define ut_join_name(a, b, c)				a##b##_##c
 #define ut_build_name(prefix, num, id)	ut_join_name(prefix, num, id)
 
+/**
+ * @macro UT_REGISTER
+ *
+ * @brief put a pointer to the object in the named section (UNITTEST_USE_SECTION != 0)
+ * the registry is walked between the linker-provided __start_* / __stop_* symbols.
+ */
+#if UNITTEST_USE_SECTION != 0
+#  if defined(__APPLE__)
+#    define UT_SECTION_NAME(sec)		"__DATA," #sec
+#  else
+#    define UT_SECTION_NAME(sec)		#sec
+#  endif
+#  define UT_REGISTER(sec, type, obj) \
+	static type const *const ut_sa_cat(ut_reg_, obj) \
+		__attribute__(( used, section(UT_SECTION_NAME(sec)), aligned(sizeof(void *)) )) = &(obj)
+#else
+#  define UT_REGISTER(sec, type, obj)	struct ut_s		/* nothing registered; consumes the semicolon */
+#endif
+
 /**
  * @macro unittest
  *
@@ -273,10 +599,31 @@ ut_static_assert(offsetof(struct ut_group_config_s, params) == offsetof(struct u
 #define UNITTEST_ARG_DECL \
 	void *ctx __attribute__(( unused )), \
 	void *gctx __attribute__(( unused )), \
+	struct ut_arena_s *ut_arena __attribute__(( unused )), \
 	struct ut_s *ut_info __attribute__(( unused )), \
 	struct ut_global_config_s const *ut_gconf __attribute__(( unused )), \
 	struct ut_group_config_s const *ut_config __attribute__(( unused ))
-#define UNITTEST_ARG_LIST 	ctx, gctx, ut_info, ut_gconf, ut_config
+#define UNITTEST_ARG_LIST 	ctx, gctx, ut_arena, ut_info, ut_gconf, ut_config
+
+/**
+ * @macro UT_BODY
+ *
+ * @brief define the body function (ut_body_*) around the user-written block (ut_impl_*).
+ * the block is inlined into the body and counts the passed assertions in a local
+ * (ut_acc), so the counter stays in a register in tight loops; it is added to
+ * ut_info->succ when the block returns.
+ */
+#define UT_BODY(id) \
+	static inline void ut_build_name(ut_impl_, UNITTEST_UNIQUE_ID, id)(UNITTEST_ARG_DECL, size_t *ut_acc) \
+		__attribute__(( always_inline )); \
+	static void ut_build_name(ut_body_, UNITTEST_UNIQUE_ID, id)(UNITTEST_ARG_DECL) \
+	{ \
+		size_t ut_acc_cnt = 0; \
+		ut_build_name(ut_impl_, UNITTEST_UNIQUE_ID, id)(UNITTEST_ARG_LIST, &ut_acc_cnt); \
+		ut_info->succ += ut_acc_cnt; \
+	} \
+	static inline void ut_build_name(ut_impl_, UNITTEST_UNIQUE_ID, id)(UNITTEST_ARG_DECL, size_t *ut_acc)
+
 #if UNITTEST != 0
 #define unittest(...) \
 	static void ut_build_name(ut_body_, UNITTEST_UNIQUE_ID, __LINE__)(UNITTEST_ARG_DECL); \
@@ -285,20 +632,54 @@ ut_static_assert(offsetof(struct ut_group_config_s, params) == offsetof(struct u
 		__FILE__, UNITTEST_UNIQUE_ID, __LINE__, 1, ut_build_name(ut_body_, UNITTEST_UNIQUE_ID, __LINE__), \
 		0, 0, 0, __VA_ARGS__ \
 	}; \
-	struct ut_s ut_build_name(ut_get_info_, UNITTEST_UNIQUE_ID, __LINE__)(void) \
+	struct ut_s const *ut_build_name(ut_get_info_, UNITTEST_UNIQUE_ID, __LINE__)(void) \
+	{ \
+		return(&ut_build_name(ut_info_, UNITTEST_UNIQUE_ID, __LINE__)); \
+	} \
+	UT_REGISTER(ut_tests, struct ut_s, ut_build_name(ut_info_, UNITTEST_UNIQUE_ID, __LINE__)); \
+	UT_BODY(__LINE__)
+
+/**
+ * @macro unittest_bench
+ *
+ * @brief instanciate a benchmark; the body is a single operation, invoked repeatedly
+ * with calibrated iteration count when run with --bench.
+ */
+#define unittest_bench(...) \
+	static void ut_build_name(ut_body_, UNITTEST_UNIQUE_ID, __LINE__)(UNITTEST_ARG_DECL); \
+	static struct ut_s const ut_build_name(ut_info_, UNITTEST_UNIQUE_ID, __LINE__) = { \
+		__FILE__, UNITTEST_UNIQUE_ID, __LINE__, 1, ut_build_name(ut_body_, UNITTEST_UNIQUE_ID, __LINE__), \
+		0, 0, 0, .bench = 1, __VA_ARGS__ \
+	}; \
+	struct ut_s const *ut_build_name(ut_get_info_, UNITTEST_UNIQUE_ID, __LINE__)(void) \
 	{ \
-		return(ut_build_name(ut_info_, UNITTEST_UNIQUE_ID, __LINE__)); \
+		return(&ut_build_name(ut_info_, UNITTEST_UNIQUE_ID, __LINE__)); \
 	} \
-	static void ut_build_name(ut_body_, UNITTEST_UNIQUE_ID, __LINE__)(UNITTEST_ARG_DECL)
+	UT_REGISTER(ut_tests, struct ut_s, ut_build_name(ut_info_, UNITTEST_UNIQUE_ID, __LINE__)); \
+	UT_BODY(__LINE__)
 
 #else	/* UNITTEST != 0 */
 
 #define unittest(...) \
-	static void ut_build_name(ut_body_, UNITTEST_UNIQUE_ID, __LINE__)(UNITTEST_ARG_DECL)
+	UT_BODY(__LINE__)
 
+#define unittest_bench(...) \
+	UT_BODY(__LINE__)
 
 #endif	/* UNITTEST != 0 */
 
+/**
+ * @macro ut_do_not_optimize, ut_clobber_memory
+ *
+ * @brief compiler barriers for benchmark bodies; the former forces the value
+ * to be computed, the latter forces pending stores to memory.
+ */
+#define ut_do_not_optimize(x) { \
+	__typeof__(x) _ut_v = (x); \
+	__asm__ __volatile__("" : "+r,m"(_ut_v) : : "memory"); \
+}
+#define ut_clobber_memory()		{ __asm__ __volatile__("" : : : "memory"); }
+
 /**
  * @macro unittest_config
  *
@@ -312,10 +693,11 @@ ut_static_assert(offsetof(struct ut_group_config_s, params) == offsetof(struct u
 		.unique_id = UNITTEST_UNIQUE_ID, \
 		__VA_ARGS__ \
 	}; \
-	struct ut_group_config_s ut_build_name(ut_get_config_, UNITTEST_UNIQUE_ID, 0)(void) \
+	struct ut_group_config_s const *ut_build_name(ut_get_config_, UNITTEST_UNIQUE_ID, 0)(void) \
 	{ \
-		return(ut_build_name(ut_config_, UNITTEST_UNIQUE_ID, __LINE__)); \
-	}
+		return(&ut_build_name(ut_config_, UNITTEST_UNIQUE_ID, __LINE__)); \
+	} \
+	UT_REGISTER(ut_groups, struct ut_group_config_s, ut_build_name(ut_config_, UNITTEST_UNIQUE_ID, __LINE__))
 
 #else	/* UNITTEST != 0 */
 
@@ -323,6 +705,135 @@ ut_static_assert(offsetof(struct ut_group_config_s, params) == offsetof(struct u
 
 #endif	/* UNITTEST != 0 */
 
+/**
+ * @struct ut_strbuf_s
+ * @brief growable string (a named utkvec_t(char)); always NUL-terminated once printed to
+ */
+struct ut_strbuf_s {
+	size_t n, m;
+	char *a;
+};
+
+static inline
+void ut_strbuf_vprintf(
+	struct ut_strbuf_s *sb,
+	char const *fmt,
+	va_list l)
+{
+	if(utkv_ptr(*sb) == NULL) { utkv_init(*sb); }
+
+	va_list lc;
+	va_copy(lc, l);
+	size_t rem = utkv_max(*sb) - utkv_size(*sb);
+	int len = vsnprintf(utkv_ptr(*sb) + utkv_size(*sb), rem, fmt, lc);
+	va_end(lc);
+	if(len < 0) { return; }
+
+	if((size_t)len >= rem) {
+		size_t req = utkv_size(*sb) + len + 1;
+		utkv_roundup32(req);
+		utkv_resize(*sb, req);
+		vsnprintf(utkv_ptr(*sb) + utkv_size(*sb), len + 1, fmt, l);
+	}
+	utkv_size(*sb) += len;
+	return;
+}
+
+static inline
+void ut_strbuf_printf(
+	struct ut_strbuf_s *sb,
+	char const *fmt,
+	...)
+{
+	va_list l;
+	va_start(l, fmt);
+	ut_strbuf_vprintf(sb, fmt, l);
+	va_end(l);
+	return;
+}
+
+/**
+ * per-thread output buffer; failure messages are formatted here and flushed
+ * with a single write at the end of each test (see ut_out_flush).
+ */
+static __thread struct ut_strbuf_s ut_out_buf;
+
+static inline
+void ut_out_vprintf(
+	char const *fmt,
+	va_list l)
+{
+	ut_strbuf_vprintf(&ut_out_buf, fmt, l);
+	return;
+}
+
+static inline
+void ut_out_printf(
+	char const *fmt,
+	...)
+{
+	va_list l;
+	va_start(l, fmt);
+	ut_out_vprintf(fmt, l);
+	va_end(l);
+	return;
+}
+
+/**
+ * @fn ut_out_write
+ * @brief write the whole chunk to the output, bypassing stdio buffering
+ */
+static inline
+void ut_out_write(
+	FILE *fp,
+	char const *buf,
+	size_t len)
+{
+	if(len == 0) { return; }
+
+	fflush(fp);
+	int fd = fileno(fp);
+	while(len > 0) {
+		ssize_t w = write(fd, buf, len);
+		if(w < 0) {
+			if(errno == EINTR) { continue; }
+			return;
+		}
+		buf += w;
+		len -= (size_t)w;
+	}
+	return;
+}
+
+/**
+ * @fn ut_out_take
+ * @brief detach the content of the buffer of the calling thread (NULL if empty)
+ */
+static inline
+char *ut_out_take(
+	size_t *len)
+{
+	*len = utkv_size(ut_out_buf);
+	if(*len == 0) { return(NULL); }
+
+	char *buf = (char *)malloc(*len);
+	memcpy(buf, utkv_ptr(ut_out_buf), *len);
+	utkv_clear(ut_out_buf);
+	return(buf);
+}
+
+/**
+ * @fn ut_out_flush
+ */
+static inline
+void ut_out_flush(
+	struct ut_global_config_s const *gconf)
+{
+	ut_out_write(gconf->fp, utkv_ptr(ut_out_buf), utkv_size(ut_out_buf));
+	utkv_clear(ut_out_buf);
+	return;
+}
+
 /* assertion failed message printers */
 static
 void ut_print_assertion_failed(
@@ -335,12 +846,13 @@ void ut_print_assertion_failed(
 	char const *fmt,
 	...)
 {
+	ut_unused(gconf);
 	ut_unused(func);
 
 	va_list l;
 	va_start(l, fmt);
 
-	fprintf(gconf->fp,
+	ut_out_printf(
 		ut_color(UT_YELLOW, "assertion failed") ": [%s] %s:" ut_color(UT_BLUE, "%zu") " (%s) `" ut_color(UT_MAGENTA, "%s") "'",
 		ut_null_replace(config->name, "no name"),
 		ut_null_replace(info->file, "(unknown filename)"),
@@ -348,10 +860,10 @@ void ut_print_assertion_failed(
 		ut_null_replace(info->name, "no name"),
 		expr);
 	if(strlen(fmt) != 0) {
-		fprintf(gconf->fp, ", ");
-		vfprintf(gconf->fp, fmt, l);
+		ut_out_printf(", ");
+		ut_out_vprintf(fmt, l);
 	}
-	fprintf(gconf->fp, "\n");
+	ut_out_printf("\n");
 	va_end(l);
 	return;
 }
@@ -367,68 +879,189 @@ void ut_print_assertion_failed_json(
 	char const *fmt,
 	...)
 {
-	ut_unused(config);
+	ut_unused(gconf);
 	ut_unused(func);
 
 	va_list l;
 	va_start(l, fmt);
 
-	fprintf(gconf->fp, "{ \"tag\": \"fail\", ");
+	ut_out_printf("{ \"tag\": \"fail\", ");
 	if(config->name != NULL) {
-		fprintf(gconf->fp, "\"group\": \"%s\", ", config->name);
+		ut_out_printf("\"group\": \"%s\", ", config->name);
 	}
 	if(config->file != NULL) {
-		fprintf(gconf->fp, "\"filename\": \"%s\", ", config->file);
+		ut_out_printf("\"filename\": \"%s\", ", config->file);
 	}
 
-	fprintf(gconf->fp, "\"line\": %zu, ", line);
+	ut_out_printf("\"line\": %zu, ", line);
 	if(info->name != NULL) {
-		fprintf(gconf->fp, "\"name\": \"%s\", ", info->name);
+		ut_out_printf("\"name\": \"%s\", ", info->name);
 	}
-	fprintf(gconf->fp, "\"expr\": \"%s\", ", expr);
+	ut_out_printf("\"expr\": \"%s\", ", expr);
 	if(strlen(fmt) != 0) {
-		fprintf(gconf->fp, "\"debugprint\": \"");
-		vfprintf(gconf->fp, fmt, l);			/* FIXME: escape */
-		fprintf(gconf->fp, "\", ");
+		ut_out_printf("\"debugprint\": \"");
+		ut_out_vprintf(fmt, l);			/* FIXME: escape */
+		ut_out_printf("\", ");
 	}
-	fprintf(gconf->fp, "},\n");
+	ut_out_printf("},\n");
 	va_end(l);
 	return;
 }
 
+/* benchmark result printers */
+static
+void ut_print_bench(
+	struct ut_s const *info,
+	struct ut_global_config_s const *gconf,
+	struct ut_group_config_s const *config,
+	struct ut_bench_result_s const *result)
+{
+	ut_unused(gconf);
+
+	ut_out_printf(
+		ut_color(UT_CYAN, "bench") ": [%s] %s:" ut_color(UT_BLUE, "%zu") " (%s) "
+		ut_color(UT_GREEN, "%.2f ns/op") " (median), MAD %.2f ns, %zu iterations x %zu samples\n",
+		ut_null_replace(config->name, "no name"),
+		ut_null_replace(info->file, "(unknown filename)"),
+		info->line,
+		ut_null_replace(info->name, "no name"),
+		result->ns_per_op,
+		result->mad,
+		result->iterations,
+		result->samples);
+	return;
+}
+
+static
+void ut_print_bench_json(
+	struct ut_s const *info,
+	struct ut_global_config_s const *gconf,
+	struct ut_group_config_s const *config,
+	struct ut_bench_result_s const *result)
+{
+	ut_unused(gconf);
+
+	ut_out_printf("{ \"tag\": \"bench\", ");
+	if(config->name != NULL) {
+		ut_out_printf("\"group\": \"%s\", ", config->name);
+	}
+	if(info->file != NULL) {
+		ut_out_printf("\"filename\": \"%s\", ", info->file);
+	}
+	ut_out_printf("\"line\": %zu, ", info->line);
+	if(info->name != NULL) {
+		ut_out_printf("\"name\": \"%s\", ", info->name);
+	}
+	ut_out_printf("\"ns_per_op\": %.3f, ", result->ns_per_op);
+	ut_out_printf("\"mad\": %.3f, ", result->mad);
+	ut_out_printf("\"iterations\": %zu, ", result->iterations);
+	ut_out_printf("\"samples\": %zu, ", result->samples);
+	ut_out_printf("},\n");
+	return;
+}
+
 /* summary printers */
+static
+int ut_compare_wall(
+	void const *_a,
+	void const *_b)
+{
+	struct ut_s const *a = *(struct ut_s const *const *)_a;
+	struct ut_s const *b = *(struct ut_s const *const *)_b;
+	if(a->wall_ns != b->wall_ns) {
+		return(a->wall_ns < b->wall_ns ? 1 : -1);
+	}
+	return((a < b) ? -1 : (a > b));
+}
+
+/**
+ * @fn ut_collect_slow_tests
+ * @brief returns executed tests in descending order of the wall-clock time
+ */
+static inline
+struct ut_s const **ut_collect_slow_tests(
+	struct ut_s const *test,
+	size_t test_cnt,
+	size_t *cnt)
+{
+	struct ut_s const **slow = (struct ut_s const **)malloc(sizeof(struct ut_s const *) * (test_cnt + 1));
+	size_t n = 0;
+	for(size_t i = 0; i < test_cnt; i++) {
+		if(test[i].exec != 0) { slow[n++] = &test[i]; }
+	}
+	qsort(slow, n, sizeof(struct ut_s const *), ut_compare_wall);
+	*cnt = n;
+	return(slow);
+}
+
+#define ut_ns_to_ms(x)		( (double)(x) / 1000000.0 )
+
 static
 void ut_print_results(
 	struct ut_global_config_s const *gconf,
 	struct ut_group_config_s const *config,
 	struct ut_result_s const *result,
-	size_t file_cnt)
+	size_t file_cnt,
+	struct ut_s const *test,
+	size_t test_cnt)
 {
 	size_t cnt = 0;
 	size_t succ = 0;
 	size_t fail = 0;
+	uint64_t wall = 0, cpu = 0;
+
+	/* slow tests */
+	size_t slow_cnt;
+	struct ut_s const **slow = ut_collect_slow_tests(test, test_cnt, &slow_cnt);
+	for(size_t i = 0; i < slow_cnt && gconf->slow_ms > 0.0; i++) {
+		if(ut_ns_to_ms(slow[i]->wall_ns) <= gconf->slow_ms) { break; }
+		fprintf(gconf->fp, ut_color(UT_YELLOW, "slow test") ": [%s] %s:" ut_color(UT_BLUE, "%zu") " (%s) took %.2f ms (> %.2f ms).\n",
+			ut_null_replace(config[slow[i]->index].name, "no name"),
+			ut_null_replace(slow[i]->file, "(unknown filename)"),
+			slow[i]->line,
+			ut_null_replace(slow[i]->name, "no name"),
+			ut_ns_to_ms(slow[i]->wall_ns),
+			gconf->slow_ms);
+	}
+	if(gconf->slowest > 0 && slow_cnt > 0) {
+		fprintf(gconf->fp, "Slowest %zu tests:\n", gconf->slowest < slow_cnt ? gconf->slowest : slow_cnt);
+	}
+	for(size_t i = 0; i < gconf->slowest && i < slow_cnt; i++) {
+		fprintf(gconf->fp, "  %10.2f ms wall, %10.2f ms cpu  [%s] %s:%zu (%s)\n",
+			ut_ns_to_ms(slow[i]->wall_ns),
+			ut_ns_to_ms(slow[i]->cpu_ns),
+			ut_null_replace(config[slow[i]->index].name, "no name"),
+			ut_null_replace(slow[i]->file, "(unknown filename)"),
+			slow[i]->line,
+			ut_null_replace(slow[i]->name, "no name"));
+	}
+	free(slow);
 
-	for(size_t i = 0, j = 0; i < file_cnt; i++) {
+	for(size_t i = 0; i < file_cnt; i++) {
 		if(config[i].exec == 0) { continue; }
 
-		fprintf(gconf->fp, "%sGroup %s: %zu succeeded, %zu failed in total %zu assertions in %zu tests.%s\n",
-			(result[j].fail == 0) ? UT_GREEN : UT_RED,
+		fprintf(gconf->fp, "%sGroup %s: %zu succeeded, %zu failed in total %zu assertions in %zu tests (%.2f ms wall, %.2f ms cpu).%s\n",
+			(result[i].fail == 0) ? UT_GREEN : UT_RED,
 			ut_null_replace(config[i].name, "(no name)"),
-			result[j].succ,
-			result[j].fail,
-			result[j].succ + result[j].fail,
-			result[j].cnt,
+			result[i].succ,
+			result[i].fail,
+			result[i].succ + result[i].fail,
+			result[i].cnt,
+			ut_ns_to_ms(result[i].wall_ns),
+			ut_ns_to_ms(result[i].cpu_ns),
 			UT_DEFAULT_COLOR);
 		
-		cnt += result[j].cnt;
-		succ += result[j].succ;
-		fail += result[j].fail;
-		j++;
+		cnt += result[i].cnt;
+		succ += result[i].succ;
+		fail += result[i].fail;
+		wall += result[i].wall_ns;
+		cpu += result[i].cpu_ns;
 	}
 
-	fprintf(gconf->fp, "%sSummary: %zu succeeded, %zu failed in total %zu assertions in %zu tests.%s\n",
+	fprintf(gconf->fp, "%sSummary: %zu succeeded, %zu failed in total %zu assertions in %zu tests (%.2f ms wall, %.2f ms cpu).%s\n",
 		(fail == 0) ? UT_GREEN : UT_RED,
 		succ, fail, succ + fail, cnt,
+		ut_ns_to_ms(wall), ut_ns_to_ms(cpu),
 		UT_DEFAULT_COLOR);
 	return;
 }
@@ -438,41 +1071,78 @@ void ut_print_results_json(
 	struct ut_global_config_s const *gconf,
 	struct ut_group_config_s const *config,
 	struct ut_result_s const *result,
-	size_t file_cnt)
+	size_t file_cnt,
+	struct ut_s const *test,
+	size_t test_cnt)
 {
 	size_t cnt = 0;
 	size_t succ = 0;
 	size_t fail = 0;
+	uint64_t wall = 0, cpu = 0;
 
 	fprintf(gconf->fp, "{ \"tag\": \"results\", [ ");
 
-	for(size_t i = 0, j = 0; i < file_cnt; i++) {
+	for(size_t i = 0; i < file_cnt; i++) {
 		if(config[i].exec == 0) { continue; }
-		if(config->name != NULL) {
-			fprintf(gconf->fp, "{ \"group\": \"%s\", ", config->name);
+		fprintf(gconf->fp, "{ ");
+		if(config[i].name != NULL) {
+			fprintf(gconf->fp, "\"group\": \"%s\", ", config[i].name);
 		}
-		if(config->file != NULL) {
-			fprintf(gconf->fp, "\"filename\": \"%s\", ", config->file);
+		if(config[i].file != NULL) {
+			fprintf(gconf->fp, "\"filename\": \"%s\", ", config[i].file);
 		}
-		fprintf(gconf->fp, "\"succeeded\": %zu, ", result[j].succ);
-		fprintf(gconf->fp, "\"failed\": %zu, ", result[j].fail);
-		fprintf(gconf->fp, "\"assertioncount\": %zu, ", result[j].succ + result[j].fail);
-		fprintf(gconf->fp, "\"testcount\": %zu, ", result[j].cnt);
+		fprintf(gconf->fp, "\"succeeded\": %zu, ", result[i].succ);
+		fprintf(gconf->fp, "\"failed\": %zu, ", result[i].fail);
+		fprintf(gconf->fp, "\"assertioncount\": %zu, ", result[i].succ + result[i].fail);
+		fprintf(gconf->fp, "\"testcount\": %zu, ", result[i].cnt);
+		fprintf(gconf->fp, "\"wall_ms\": %.3f, ", ut_ns_to_ms(result[i].wall_ns));
+		fprintf(gconf->fp, "\"cpu_ms\": %.3f, ", ut_ns_to_ms(result[i].cpu_ns));
 		fprintf(gconf->fp, "}, ");
 		
-		cnt += result[j].cnt;
-		succ += result[j].succ;
-		fail += result[j].fail;
-		j++;
+		cnt += result[i].cnt;
+		succ += result[i].succ;
+		fail += result[i].fail;
+		wall += result[i].wall_ns;
+		cpu += result[i].cpu_ns;
 	}
 	fprintf(gconf->fp, "] },\n");
 
+	/* slowest tests; all the tests above the threshold are listed as well */
+	size_t slow_cnt;
+	struct ut_s const **slow = ut_collect_slow_tests(test, test_cnt, &slow_cnt);
+	if(gconf->slowest > 0 || gconf->slow_ms > 0.0) {
+		fprintf(gconf->fp, "{ \"tag\": \"slowest\", [ ");
+		for(size_t i = 0; i < slow_cnt; i++) {
+			int const is_slow = gconf->slow_ms > 0.0 && ut_ns_to_ms(slow[i]->wall_ns) > gconf->slow_ms;
+			if(i >= gconf->slowest && is_slow == 0) { break; }
+
+			fprintf(gconf->fp, "{ ");
+			if(config[slow[i]->index].name != NULL) {
+				fprintf(gconf->fp, "\"group\": \"%s\", ", config[slow[i]->index].name);
+			}
+			if(slow[i]->file != NULL) {
+				fprintf(gconf->fp, "\"filename\": \"%s\", ", slow[i]->file);
+			}
+			fprintf(gconf->fp, "\"line\": %zu, ", slow[i]->line);
+			if(slow[i]->name != NULL) {
+				fprintf(gconf->fp, "\"name\": \"%s\", ", slow[i]->name);
+			}
+			fprintf(gconf->fp, "\"wall_ms\": %.3f, ", ut_ns_to_ms(slow[i]->wall_ns));
+			fprintf(gconf->fp, "\"cpu_ms\": %.3f, ", ut_ns_to_ms(slow[i]->cpu_ns));
+			fprintf(gconf->fp, "\"slow\": %s, ", is_slow ? "true" : "false");
+			fprintf(gconf->fp, "}, ");
+		}
+		fprintf(gconf->fp, "] },\n");
+	}
+	free(slow);
 
 	fprintf(gconf->fp, "{ \"tag\": \"summary\", ");
 	fprintf(gconf->fp, "\"succeeded\": %zu, ", succ);
 	fprintf(gconf->fp, "\"failed\": %zu, ", fail);
 	fprintf(gconf->fp, "\"assertioncount\": %zu, ", succ + fail);
 	fprintf(gconf->fp, "\"testcount\": %zu, ", cnt);
+	fprintf(gconf->fp, "\"wall_ms\": %.3f, ", ut_ns_to_ms(wall));
+	fprintf(gconf->fp, "\"cpu_ms\": %.3f, ", ut_ns_to_ms(cpu));
 	fprintf(gconf->fp, "},\n");
 
 	return;
@@ -481,351 +1151,2262 @@ void ut_print_results_json(
 static
 struct ut_printer_s ut_default_printer = {
 	.failed = ut_print_assertion_failed,
-	.result = ut_print_results
+	.result = ut_print_results,
+	.bench = ut_print_bench
 };
 
 static
 struct ut_printer_s ut_json_printer = {
 	.failed = ut_print_assertion_failed_json,
-	.result = ut_print_results_json
+	.result = ut_print_results_json,
+	.bench = ut_print_bench_json
 };
 
 /**
- * memory dump macro
- */
-#define ut_dump(ptr, len) ({ \
-	size_t _size = (((len) + 15) / 16 + 1) * \
-		(strlen("0x0123456789abcdef:") + 16 * strlen(" 00a") + strlen("  \n+ margin")) \
-		+ strlen(#ptr) + strlen("\n`' len: 100000000"); \
-	uint8_t *_ptr = (uint8_t *)(ptr); \
-	char *_str = alloca(_size); \
-	char *_s = _str; \
-	/* make header */ \
-	_s += sprintf(_s, "\n`%s' len: %zu\n", #ptr, (size_t)len); \
-	_s += sprintf(_s, "                   "); \
-	for(size_t i = 0; i < 16; i++) { \
-		_s += sprintf(_s, " %02x", (uint8_t)i); \
-	} \
-	_s += sprintf(_s, "\n"); \
-	for(size_t i = 0; i < ((len) + 15) / 16; i++) { \
-		_s += sprintf(_s, "0x%016zu:", (size_t)_ptr); \
-		for(size_t j = 0; j < 16; j++) { \
-			_s += sprintf(_s, " %02x", (uint8_t)_ptr[j]); \
-		} \
-		_s += sprintf(_s, "  "); \
-		for(size_t j = 0; j < 16; j++) { \
-			_s += sprintf(_s, "%c", isprint(_ptr[j]) ? _ptr[j] : ' '); \
-		} \
-		_s += sprintf(_s, "\n"); \
-		_ptr += 16; \
-	} \
-	(char const *)_str; \
-})
-#ifndef dump
-// #define dump 			ut_dump
+ * memory dump
+ */
+#ifndef UNITTEST_DUMP_MAX
+#define UNITTEST_DUMP_MAX			( 4096 )	/* bytes dumped at most; the rest is elided */
 #endif
+#define UNITTEST_DUMP_RING			( 4 )		/* dumps alive at a time (per thread), e.g. in one assertion */
+
+#define ut_hex_char(x)				( "0123456789abcdef"[(x) & 0xf] )
 
 /**
- * assertion macro
+ * @fn ut_dump_row
+ * @brief format columns [b, e) of a 16-byte row in " %02x"; the others are blank
  */
-#define ut_assert(expr, ...) { \
-	if(expr) { \
-		ut_info->succ++; \
-	} else { \
-		ut_info->fail++; \
-		/* dump debug information */ \
-		ut_gconf->printer.failed(ut_info, ut_gconf, ut_config, __LINE__, __func__, #expr, "" __VA_ARGS__); \
-	} \
+static inline
+char *ut_dump_row(
+	char *s,
+	uint8_t const *p,
+	size_t b,
+	size_t e)
+{
+	for(size_t j = 0; j < 16; j++) {
+		int const in = j >= b && j < e;
+		s[0] = ' ';
+		s[1] = in ? ut_hex_char(p[j]>>4) : ' ';
+		s[2] = in ? ut_hex_char(p[j]) : ' ';
+		s += 3;
+	}
+	return(s);
 }
-#ifndef assert
-// #define assert			ut_assert
-#endif
 
 /**
- * @struct ut_nm_result_s
- * @brief parsed result container
+ * @fn ut_dump_buf
+ * @brief per-thread ring of heap buffers; a dump stays valid until UNITTEST_DUMP_RING more are made
  */
-struct ut_nm_result_s {
-	void *ptr;
-	char type;
-	char name[255];
-};
+static __thread struct ut_dump_buf_s {
+	char *ptr;
+	size_t size;
+} ut_dump_ring[UNITTEST_DUMP_RING];
+static __thread size_t ut_dump_cnt;
 
 static inline
-int ut_strcmp(
-	char const *a,
-	char const *b)
+char *ut_dump_buf(
+	size_t size)
 {
-	/* if both are NULL */
-	if(a == NULL && b == NULL) {
-		return(0);
+	struct ut_dump_buf_s *b = &ut_dump_ring[ut_dump_cnt++ % UNITTEST_DUMP_RING];
+	if(b->size < size) {
+		free(b->ptr);
+		b->ptr = (char *)malloc(size);
+		b->size = size;
 	}
+	return(b->ptr);
+}
 
-	if(b == NULL) {
-		return(1);
-	}
-	if(a == NULL) {
-		return(-1);
+/**
+ * @fn ut_dump_buf_destroy
+ * @brief free the ring of the calling thread (at the exit of the workers)
+ */
+static inline
+void ut_dump_buf_destroy(void)
+{
+	for(size_t i = 0; i < UNITTEST_DUMP_RING; i++) {
+		free(ut_dump_ring[i].ptr);
+		ut_dump_ring[i] = (struct ut_dump_buf_s){ 0 };
 	}
-	return(strcmp(a, b));
+	return;
 }
 
+/**
+ * @fn ut_dump_impl
+ * @brief hex dump of [offset, offset + window) of the len-byte buffer, at most
+ * UNITTEST_DUMP_MAX bytes. rows are aligned to ptr, and runs of rows repeating
+ * the previous one are collapsed into `*'.
+ */
 static inline
-char *ut_build_nm_cmd(
-	char const *filename)
+char const *ut_dump_impl(
+	char const *name,
+	void const *ptr,
+	size_t len,
+	size_t offset,
+	size_t window)
 {
-	size_t const filename_len_limit = 1024;
-	char const *cmd_base = "nm ";
-
-	/* check the length of the filename */
-	if(strlen(filename) > filename_len_limit) {
-		return(NULL);
+	uint8_t const *p = (uint8_t const *)ptr;
+
+	/* clip the window to the buffer, then to the limit */
+	size_t const lo = offset < len ? offset : len;
+	size_t hi = window < len - lo ? lo + window : len;
+	size_t const elided = hi - lo > UNITTEST_DUMP_MAX ? hi - lo - UNITTEST_DUMP_MAX : 0;
+	hi -= elided;
+
+	/* header and footer, and rows of 19 + 16 * 3 + 2 + 16 + 1 chars */
+	size_t const row_lo = lo / 16, row_hi = (hi + 15) / 16;
+	char *str = ut_dump_buf(strlen(name) + 192 + (row_hi - row_lo) * 88);
+	char *s = str;
+
+	/* make header */
+	s += sprintf(s, "\n`%s' len: %zu", name, len);
+	if(lo != 0 || hi != len) {
+		s += sprintf(s, ", showing [0x%zx, 0x%zx)", lo, hi);
 	}
+	s += sprintf(s, "\n                   ");
+	for(size_t j = 0; j < 16; j++) {
+		s[0] = ' '; s[1] = '0'; s[2] = ut_hex_char(j);
+		s += 3;
+	}
+	*s++ = '\n';
+
+	int collapsed = 0;
+	for(size_t r = row_lo; r < row_hi; r++) {
+		uint8_t const *q = p + 16 * r;
+		size_t const b = 16 * r < lo ? lo - 16 * r : 0;
+		size_t const e = 16 * r + 16 > hi ? hi - 16 * r : 16;
+
+		/* the last row is always printed, to show where the run ends */
+		if(r > row_lo && 16 * (r - 1) >= lo && e == 16 && r + 1 < row_hi && memcmp(q, q - 16, 16) == 0) {
+			if(collapsed == 0) { *s++ = '*'; *s++ = '\n'; }
+			collapsed = 1;
+			continue;
+		}
+		collapsed = 0;
 
-	/* cat name */
-	char *cmd = (char *)malloc(strlen(cmd_base) + strlen(filename) + 1);
-	strcpy(cmd, cmd_base);
-	strcat(cmd, filename);
+		/* address */
+		uintptr_t const addr = (uintptr_t)q;
+		*s++ = '0'; *s++ = 'x';
+		for(size_t k = 0; k < 16; k++) {
+			*s++ = ut_hex_char((uint64_t)addr>>(60 - 4 * k));
+		}
+		*s++ = ':';
 
-	return(cmd);
+		/* hex and ascii */
+		s = ut_dump_row(s, q, b, e);
+		*s++ = ' '; *s++ = ' ';
+		for(size_t j = 0; j < 16; j++) {
+			*s++ = j >= b && j < e && q[j] >= 0x20 && q[j] < 0x7f ? (char)q[j] : ' ';
+		}
+		*s++ = '\n';
+	}
+	if(elided != 0) {
+		s += sprintf(s, "... %zu bytes elided (UNITTEST_DUMP_MAX)\n", elided);
+	}
+	*s = '\0';
+	return(str);
 }
 
-static inline
-char *ut_dump_file(
-	FILE *fp)
-{
-	int c;
-	utkvec_t(char) buf;
+/**
+ * @macro ut_dump, ut_dump_window
+ *
+ * @brief hex dump of the buffer (or its [offset, offset + window) part) for the `%s'
+ * in the assertion message
+ */
+#define ut_dump(ptr, len) \
+	ut_dump_impl(#ptr, (void const *)(ptr), (size_t)(len), 0, (size_t)(len))
+#define ut_dump_window(ptr, len, offset, window) \
+	ut_dump_impl(#ptr, (void const *)(ptr), (size_t)(len), (size_t)(offset), (size_t)(window))
+#ifndef dump
+// #define dump 			ut_dump
+#endif
 
-	utkv_init(buf);
-	while((c = getc(fp)) != EOF) {
-		utkv_push(buf, c);
-	}
+/**
+ * assertion macro; passes are counted on the local accumulator of the test body,
+ * or directly on ut_info where no accumulator is in scope (ut_acc is NULL).
+ */
+static size_t *const ut_acc __attribute__(( unused )) = NULL;
 
-	/* push terminator */
-	utkv_push(buf, '\0');
-	return(utkv_ptr(buf));
+#define ut_assert_succ()	{ if(ut_acc != NULL) { (*ut_acc)++; } else { ut_info->succ++; } }
+
+#define ut_assert(expr, ...) { \
+	if(__builtin_expect(!!(expr), 1)) { \
+		ut_assert_succ(); \
+	} else { \
+		ut_info->fail++; \
+		/* dump debug information */ \
+		ut_gconf->printer.failed(ut_info, ut_gconf, ut_config, __LINE__, __func__, #expr, "" __VA_ARGS__); \
+	} \
 }
+#ifndef assert
+// #define assert			ut_assert
+#endif
+
+/**
+ * @macro ut_assert_cheap, ut_assert_expensive
+ *
+ * @brief tiered assertions, enabled by UT_ASSERT_LEVEL (>= 1 and >= 2 respectively).
+ * disabled ones are still parsed and type-checked, but never evaluated.
+ */
+#if UT_ASSERT_LEVEL >= 1
+#  define ut_assert_cheap(...)		ut_assert(__VA_ARGS__)
+#else
+#  define ut_assert_cheap(...)		{ if(0) ut_assert(__VA_ARGS__) }
+#endif
+
+#if UT_ASSERT_LEVEL >= 2
+#  define ut_assert_expensive(...)	ut_assert(__VA_ARGS__)
+#else
+#  define ut_assert_expensive(...)	{ if(0) ut_assert(__VA_ARGS__) }
+#endif
 
+/**
+ * @fn ut_mem_find_diff
+ * @brief offset of the first differing byte of a and b, len if they are equal
+ */
 static inline
-char *ut_dump_nm_output(
-	char const *filename)
+size_t ut_mem_find_diff(
+	uint8_t const *a,
+	uint8_t const *b,
+	size_t len)
 {
-	char *cmd = NULL;
-	FILE *fp = NULL;
-	char *res = NULL;
-
-	/* build command */
-	if((cmd = ut_build_nm_cmd(filename)) == NULL) {
-		goto _ut_nm_error_handler;
+	size_t i = 0;
+	#if defined(__AVX2__)
+	for(; i + 64 <= len; i += 64) {
+		__m256i const e0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const *)&a[i]), _mm256_loadu_si256((__m256i const *)&b[i]));
+		__m256i const e1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const *)&a[i + 32]), _mm256_loadu_si256((__m256i const *)&b[i + 32]));
+		if((uint32_t)_mm256_movemask_epi8(_mm256_and_si256(e0, e1)) == 0xffffffff) { continue; }
+
+		uint64_t const ne = ~(((uint64_t)(uint32_t)_mm256_movemask_epi8(e1)<<32) | (uint32_t)_mm256_movemask_epi8(e0));
+		return(i + __builtin_ctzll(ne));
 	}
-
-	/* open */
-	if((fp = popen(cmd, "r")) == NULL) {
-		fprintf(stderr, ut_color(UT_RED, "ERROR") ": failed to open pipe.\n");
-		goto _ut_nm_error_handler;
+	#endif
+	#if defined(__SSE2__)
+	for(; i + 32 <= len; i += 32) {
+		__m128i const e0 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *)&a[i]), _mm_loadu_si128((__m128i const *)&b[i]));
+		__m128i const e1 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *)&a[i + 16]), _mm_loadu_si128((__m128i const *)&b[i + 16]));
+		if(_mm_movemask_epi8(_mm_and_si128(e0, e1)) == 0xffff) { continue; }
+
+		uint32_t const ne = ~(((uint32_t)_mm_movemask_epi8(e1)<<16) | (uint32_t)_mm_movemask_epi8(e0));
+		return(i + __builtin_ctz(ne));
 	}
-
-	/* dump */
-	if((res = ut_dump_file(fp)) == NULL) {
-		fprintf(stderr, ut_color(UT_RED, "ERROR") ": failed to read nm output.\n");
-		goto _ut_nm_error_handler;
+	#elif defined(__ARM_NEON) && defined(__aarch64__)
+	for(; i + 16 <= len; i += 16) {
+		uint8x16_t const e = vceqq_u8(vld1q_u8(&a[i]), vld1q_u8(&b[i]));
+		if(vminvq_u8(e) == 0xff) { continue; }
+		break;				/* located bytewise below */
 	}
+	#endif
 
-	/* close file */
-	if(pclose(fp) != 0) {
-		fprintf(stderr, ut_color(UT_RED, "ERROR") ": failed to close pipe.\n");
-		goto _ut_nm_error_handler;
+	/* eight bytes at a time, then the tail */
+	for(; i + 8 <= len; i += 8) {
+		uint64_t x, y;
+		memcpy(&x, &a[i], 8);
+		memcpy(&y, &b[i], 8);
+		if(x != y) { break; }
 	}
-	free(cmd); cmd = NULL;
-	return(res);
-
-_ut_nm_error_handler:
-	if(cmd != NULL) { free(cmd); }
-	if(fp != NULL) { pclose(fp); }
-	if(res != NULL) { free(res); }
-	return(NULL);
+	for(; i < len; i++) {
+		if(a[i] != b[i]) { return(i); }
+	}
+	return(len);
 }
 
+/**
+ * @fn ut_mem_count_diff
+ * @brief number of differing bytes of a and b
+ */
 static inline
-struct ut_nm_result_s *ut_parse_nm_output(
-	char const *str)
+size_t ut_mem_count_diff(
+	uint8_t const *a,
+	uint8_t const *b,
+	size_t len)
 {
-	char const *p = str;
-	utkvec_t(struct ut_nm_result_s) buf;
-
-	utkv_init(buf);
-	while(*p != '\0') {
-		struct ut_nm_result_s r;
+	size_t i = 0, cnt = 0;
+	#if defined(__AVX2__)
+	for(; i + 32 <= len; i += 32) {
+		__m256i const e = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const *)&a[i]), _mm256_loadu_si256((__m256i const *)&b[i]));
+		cnt += 32 - __builtin_popcount((uint32_t)_mm256_movemask_epi8(e));
+	}
+	#endif
+	#if defined(__SSE2__)
+	for(; i + 16 <= len; i += 16) {
+		__m128i const e = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *)&a[i]), _mm_loadu_si128((__m128i const *)&b[i]));
+		cnt += 16 - __builtin_popcount((uint32_t)_mm_movemask_epi8(e));
+	}
+	#elif defined(__ARM_NEON) && defined(__aarch64__)
+	for(; i + 16 <= len; i += 16) {
+		uint8x16_t const ne = vmvnq_u8(vceqq_u8(vld1q_u8(&a[i]), vld1q_u8(&b[i])));
+		cnt += vaddvq_u8(vshrq_n_u8(ne, 7));
+	}
+	#endif
+	for(; i < len; i++) {
+		cnt += a[i] != b[i];
+	}
+	return(cnt);
+}
 
-		/* check the sanity of the line */
-		char const *sp = p;
-		while(*sp != '\r' && *sp != '\n' && *sp != '\0') { sp++; }
-		// printf("%p, %p, %zu\n", p, sp, (size_t)(sp - p));
-		if((size_t)(sp - p) < 1) { break; }
+/**
+ * @fn ut_mem_diff_window
+ * @brief side-by-side hex dump (in the ut_dump layout) of the rows around the
+ * first mismatch; bytes that differ are marked with ^^ on the following line.
+ * returns a malloc'd string.
+ */
+#ifndef UNITTEST_MEM_EQ_CONTEXT
+#define UNITTEST_MEM_EQ_CONTEXT		( 2 )		/* rows shown before and after the first mismatch */
+#endif
 
-		/* if the first character of the line is space, pass the PTR state */
-		if(!isspace(*p)) {
-			char *np;
-			r.ptr = (void *)((size_t)strtoll(p, &np, 16));
+static inline
+char *ut_mem_diff_window(
+	uint8_t const *a,
+	uint8_t const *b,
+	size_t len,
+	size_t pos,
+	char const *name_a,
+	char const *name_b)
+{
+	size_t const diff_cnt = ut_mem_count_diff(a, b, len);
+	size_t const row = pos / 16;
+	size_t const lo = row > UNITTEST_MEM_EQ_CONTEXT ? row - UNITTEST_MEM_EQ_CONTEXT : 0;
+	size_t const hi = row + UNITTEST_MEM_EQ_CONTEXT + 1 < (len + 15) / 16 ? row + UNITTEST_MEM_EQ_CONTEXT + 1 : (len + 15) / 16;
+
+	/* header, column indices, and (row, marker) pairs of 19 + 2 * 16 * 3 + 2 + 1 chars each */
+	size_t const size = strlen(name_a) + strlen(name_b) + 128 + (2 * (hi - lo) + 1) * 128;
+	char *str = (char *)malloc(size), *s = str;
+
+	s += sprintf(s, "\n`%s' vs `%s' len: %zu, %zu byte%s differ, first at offset 0x%zx\n",
+		name_a, name_b, len, diff_cnt, diff_cnt == 1 ? "" : "s", pos);
+	s += sprintf(s, "                   ");
+	for(size_t k = 0; k < 2; k++) {
+		s += sprintf(s, k == 0 ? "" : "  ");
+		for(size_t j = 0; j < 16; j++) { s += sprintf(s, " %02x", (uint8_t)j); }
+	}
+	s += sprintf(s, "\n");
 
-			/* advance pointer */
-			p = np;
+	for(size_t r = lo; r < hi; r++) {
+		size_t const base = r * 16, cnt = len - base < 16 ? len - base : 16;
+		int marked = 0;
 
-			// printf("ptr field found: %p\n", r.ptr);
+		s += sprintf(s, "0x%016zx:", base);
+		s = ut_dump_row(s, a + base, 0, cnt);
+		*s++ = ' '; *s++ = '|';
+		s = ut_dump_row(s, b + base, 0, cnt);
+		*s++ = '\n';
+
+		/* markers */
+		char *m = s;
+		s += sprintf(s, "                   ");
+		for(size_t k = 0; k < 2; k++) {
+			s += sprintf(s, k == 0 ? "" : "  ");
+			for(size_t j = 0; j < 16; j++) {
+				int const ne = j < cnt && a[base + j] != b[base + j];
+				s += sprintf(s, ne ? " ^^" : "   ");
+				marked |= ne;
+			}
+		}
+		if(marked == 0) {
+			*(s = m) = '\0';		/* rows without mismatches get no marker line */
 		} else {
-			r.ptr = NULL;
-
-			// printf("ptr field not found\n");
+			while(s[-1] == ' ') { s--; }
+			s += sprintf(s, "\n");
 		}
+	}
+	return(str);
+}
 
-		/* parse type */
-		while(isspace(*p)) { p++; }
-		r.type = *p++;
+/**
+ * @macro ut_assert_mem_eq
+ *
+ * @brief assert that the len bytes of a and b are the same. on failure, the
+ * number of differing bytes and the rows around the first one are printed.
+ */
+#define ut_assert_mem_eq(a, b, len) { \
+	uint8_t const *_ut_a = (uint8_t const *)(a), *_ut_b = (uint8_t const *)(b); \
+	size_t const _ut_len = (size_t)(len); \
+	size_t const _ut_pos = ut_mem_find_diff(_ut_a, _ut_b, _ut_len); \
+	if(__builtin_expect(_ut_pos == _ut_len, 1)) { \
+		ut_assert_succ(); \
+	} else { \
+		ut_info->fail++; \
+		char *_ut_str = ut_mem_diff_window(_ut_a, _ut_b, _ut_len, _ut_pos, #a, #b); \
+		ut_gconf->printer.failed(ut_info, ut_gconf, ut_config, __LINE__, __func__, \
+			"ut_assert_mem_eq(" #a ", " #b ", " #len ")", "%s", _ut_str); \
+		free(_ut_str); \
+	} \
+}
 
-		// printf("type found %c\n", r.type);
+/**
+ * @enum ut_array_kind_e
+ * @brief element classes of ut_assert_array_eq / _near; the element type is
+ * encoded as (kind * 16 + sizeof(element)).
+ */
+enum ut_array_kind_e {
+	UT_ARRAY_SIGNED = 0,
+	UT_ARRAY_UNSIGNED,
+	UT_ARRAY_FLOAT
+};
 
-		/* parse name */
-		while(isspace(*p)) { p++; }
-		if(*p == '_') { p++; }
-		int name_idx = 0;
-		while(*p != '\n' && name_idx < 254) {
-			r.name[name_idx++] = *p++;
-		}
-		r.name[name_idx] = '\0';
+#define ut_array_kind(x) _Generic((x), \
+	char: ((char)-1 < 0 ? UT_ARRAY_SIGNED : UT_ARRAY_UNSIGNED), \
+	signed char: UT_ARRAY_SIGNED, short: UT_ARRAY_SIGNED, int: UT_ARRAY_SIGNED, \
+	long: UT_ARRAY_SIGNED, long long: UT_ARRAY_SIGNED, \
+	unsigned char: UT_ARRAY_UNSIGNED, unsigned short: UT_ARRAY_UNSIGNED, unsigned int: UT_ARRAY_UNSIGNED, \
+	unsigned long: UT_ARRAY_UNSIGNED, unsigned long long: UT_ARRAY_UNSIGNED, \
+	float: UT_ARRAY_FLOAT, double: UT_ARRAY_FLOAT \
+)
+#define ut_array_type(p)			( ut_array_kind(*(p)) * 16 + (int)sizeof(*(p)) )
+#define UT_ARRAY_TYPE(kind, size)	( (kind) * 16 + (size) )
+
+#ifndef UNITTEST_ARRAY_REPORT_MAX
+#define UNITTEST_ARRAY_REPORT_MAX	( 8 )		/* mismatches listed in the message */
+#endif
 
-		// printf("name found %s\n", r.name);
+/**
+ * @struct ut_array_cmp_s
+ * @brief arguments of an array assertion. integers and floats in ULP mode are
+ * compared as monotonic integer keys (distance <= tol); floats in absolute mode by
+ * |a - b| <= abs_tol. NaNs match only NaNs.
+ */
+struct ut_array_cmp_s {
+	int type;
+	int use_abs;
+	void const *a, *b;
+	size_t n;
+	uint64_t tol;
+	double abs_tol;
+};
 
-		/* adjust the pointer to the head of the next line */
-		while(*p == '\r' || *p == '\n') { p++; }
+/* monotonic keys of type _k; -0.0 and +0.0 share a key */
+#define ut_array_key_s(_k, x)	( (_k)(x) ^ ((_k)1<<(8 * sizeof(_k) - 1)) )
+#define ut_array_key_u(_k, x)	( (_k)(x) )
+#define ut_array_key_f32(_k, x) ({ \
+	uint32_t _u; memcpy(&_u, &(x), 4); \
+	uint32_t const _m = _u & 0x7fffffff; \
+	(_k)((_u>>31) ? 0x80000000U - _m : 0x80000000U + _m); \
+})
+#define ut_array_key_f64(_k, x) ({ \
+	uint64_t _u; memcpy(&_u, &(x), 8); \
+	uint64_t const _m = _u & 0x7fffffffffffffffULL; \
+	(_k)((_u>>63) ? 0x8000000000000000ULL - _m : 0x8000000000000000ULL + _m); \
+})
+#define ut_array_nan_int(x)		( 0 )
+#define ut_array_nan_float(x)	( (x) != (x) )
 
-		/* push */
-		utkv_push(buf, r);
+/**
+ * @fn ut_array_count_*
+ * @brief number of elements out of the tolerance. the loops are branchless and the
+ * keys no wider than the elements (but 32 bits), so that they are vectorized.
+ */
+#define UT_ARRAY_COUNT_KEY(_suffix, _t, _k, _key, _nan) \
+	static inline \
+	size_t ut_build_name(ut_array_count_, _suffix, key)(void const *pa, void const *pb, size_t n, uint64_t tol64) \
+	{ \
+		_t const *a = (_t const *)pa, *b = (_t const *)pb; \
+		_k const tol = tol64 > (_k)-1 ? (_k)-1 : (_k)tol64; \
+		size_t cnt = 0; \
+		for(size_t i = 0; i < n; i++) { \
+			_k const x = _key(_k, a[i]), y = _key(_k, b[i]); \
+			int const na = _nan(a[i]), nb = _nan(b[i]); \
+			cnt += (na ^ nb) | (!(na | nb) & ((x > y ? x - y : y - x) > tol)); \
+		} \
+		return(cnt); \
+	}
+#define UT_ARRAY_COUNT_ABS(_suffix, _t, _fabs) \
+	static inline \
+	size_t ut_build_name(ut_array_count_, _suffix, abs)(void const *pa, void const *pb, size_t n, double tol64) \
+	{ \
+		_t const *a = (_t const *)pa, *b = (_t const *)pb; \
+		_t const tol = (_t)tol64; \
+		size_t cnt = 0; \
+		for(size_t i = 0; i < n; i++) { \
+			int const na = a[i] != a[i], nb = b[i] != b[i]; \
+			cnt += (na ^ nb) | (!(na | nb) & (a[i] != b[i]) & !(_fabs(a[i] - b[i]) <= tol)); \
+		} \
+		return(cnt); \
 	}
 
-	/* push terminator */
-	utkv_push(buf, (struct ut_nm_result_s){ 0 });
-	return(utkv_ptr(buf));
-}
+UT_ARRAY_COUNT_KEY(i8, int8_t, uint32_t, ut_array_key_s, ut_array_nan_int)
+UT_ARRAY_COUNT_KEY(i16, int16_t, uint32_t, ut_array_key_s, ut_array_nan_int)
+UT_ARRAY_COUNT_KEY(i32, int32_t, uint32_t, ut_array_key_s, ut_array_nan_int)
+UT_ARRAY_COUNT_KEY(i64, int64_t, uint64_t, ut_array_key_s, ut_array_nan_int)
+UT_ARRAY_COUNT_KEY(u8, uint8_t, uint32_t, ut_array_key_u, ut_array_nan_int)
+UT_ARRAY_COUNT_KEY(u16, uint16_t, uint32_t, ut_array_key_u, ut_array_nan_int)
+UT_ARRAY_COUNT_KEY(u32, uint32_t, uint32_t, ut_array_key_u, ut_array_nan_int)
+UT_ARRAY_COUNT_KEY(u64, uint64_t, uint64_t, ut_array_key_u, ut_array_nan_int)
+UT_ARRAY_COUNT_KEY(f32, float, uint32_t, ut_array_key_f32, ut_array_nan_float)
+UT_ARRAY_COUNT_KEY(f64, double, uint64_t, ut_array_key_f64, ut_array_nan_float)
+UT_ARRAY_COUNT_ABS(f32, float, __builtin_fabsf)
+UT_ARRAY_COUNT_ABS(f64, double, __builtin_fabs)
 
+/**
+ * @fn ut_array_count
+ * @brief number of mismatching elements
+ */
 static inline
-struct ut_nm_result_s *ut_nm(
-	char const *filename)
+size_t ut_array_count(
+	struct ut_array_cmp_s const *c)
 {
-	char const *str = NULL;
-	struct ut_nm_result_s *res = NULL;
-
-	if((str = ut_dump_nm_output(filename)) == NULL) {
-		return(NULL);
+	/* exact comparison of integers is bytewise */
+	size_t const size = c->type % 16;
+	if(c->type / 16 != UT_ARRAY_FLOAT && c->tol == 0
+	&& ut_mem_find_diff((uint8_t const *)c->a, (uint8_t const *)c->b, c->n * size) == c->n * size) {
+		return(0);
 	}
-	res = ut_parse_nm_output(str);
-	
-	free((void *)str);
-	return(res);
-}
 
-static inline
-int ut_startswith(char const *str, char const *prefix)
-{
-	while(*str != '\0' && *prefix != '\0') {
-		if(*str++ != *prefix++) { return(1); }
+	switch(c->type) {
+		case UT_ARRAY_TYPE(UT_ARRAY_SIGNED, 1): return(ut_array_count_i8_key(c->a, c->b, c->n, c->tol));
+		case UT_ARRAY_TYPE(UT_ARRAY_SIGNED, 2): return(ut_array_count_i16_key(c->a, c->b, c->n, c->tol));
+		case UT_ARRAY_TYPE(UT_ARRAY_SIGNED, 4): return(ut_array_count_i32_key(c->a, c->b, c->n, c->tol));
+		case UT_ARRAY_TYPE(UT_ARRAY_SIGNED, 8): return(ut_array_count_i64_key(c->a, c->b, c->n, c->tol));
+		case UT_ARRAY_TYPE(UT_ARRAY_UNSIGNED, 1): return(ut_array_count_u8_key(c->a, c->b, c->n, c->tol));
+		case UT_ARRAY_TYPE(UT_ARRAY_UNSIGNED, 2): return(ut_array_count_u16_key(c->a, c->b, c->n, c->tol));
+		case UT_ARRAY_TYPE(UT_ARRAY_UNSIGNED, 4): return(ut_array_count_u32_key(c->a, c->b, c->n, c->tol));
+		case UT_ARRAY_TYPE(UT_ARRAY_UNSIGNED, 8): return(ut_array_count_u64_key(c->a, c->b, c->n, c->tol));
+		case UT_ARRAY_TYPE(UT_ARRAY_FLOAT, 4):
+			return(c->use_abs ? ut_array_count_f32_abs(c->a, c->b, c->n, c->abs_tol) : ut_array_count_f32_key(c->a, c->b, c->n, c->tol));
+		case UT_ARRAY_TYPE(UT_ARRAY_FLOAT, 8):
+			return(c->use_abs ? ut_array_count_f64_abs(c->a, c->b, c->n, c->abs_tol) : ut_array_count_f64_key(c->a, c->b, c->n, c->tol));
+		default: return(c->n);
 	}
-	return(*prefix == '\0' ? 0 : 1);
 }
 
+/**
+ * @fn ut_array_elem
+ * @brief format the i-th element of p into buf (unless NULL); returns its key (and its value in *val)
+ */
 static inline
-struct ut_s *ut_get_unittest(
-	struct ut_nm_result_s const *res)
+uint64_t ut_array_elem(
+	int type,
+	void const *p,
+	size_t i,
+	double *val,
+	char *buf)
 {
-	/* extract offset */
-	uintptr_t offset = (uintptr_t)-1LL;
-	struct ut_nm_result_s const *r = res;
-	while(r->type != (char)0) {
-		if(ut_strcmp("main", r->name) == 0) {
-			offset = (uintptr_t)main - (uintptr_t)r->ptr;
+	int64_t s = 0;
+	uint64_t u = 0;
+	switch(type) {
+		case UT_ARRAY_TYPE(UT_ARRAY_SIGNED, 1): s = ((int8_t const *)p)[i]; break;
+		case UT_ARRAY_TYPE(UT_ARRAY_SIGNED, 2): s = ((int16_t const *)p)[i]; break;
+		case UT_ARRAY_TYPE(UT_ARRAY_SIGNED, 4): s = ((int32_t const *)p)[i]; break;
+		case UT_ARRAY_TYPE(UT_ARRAY_SIGNED, 8): s = ((int64_t const *)p)[i]; break;
+		case UT_ARRAY_TYPE(UT_ARRAY_UNSIGNED, 1): u = ((uint8_t const *)p)[i]; break;
+		case UT_ARRAY_TYPE(UT_ARRAY_UNSIGNED, 2): u = ((uint16_t const *)p)[i]; break;
+		case UT_ARRAY_TYPE(UT_ARRAY_UNSIGNED, 4): u = ((uint32_t const *)p)[i]; break;
+		case UT_ARRAY_TYPE(UT_ARRAY_UNSIGNED, 8): u = ((uint64_t const *)p)[i]; break;
+		case UT_ARRAY_TYPE(UT_ARRAY_FLOAT, 4): {
+			float const x = ((float const *)p)[i];
+			if(buf != NULL) { sprintf(buf, "%.9g", x); }
+			*val = x;
+			return(ut_array_key_f32(uint64_t, x));
+		}
+		case UT_ARRAY_TYPE(UT_ARRAY_FLOAT, 8): {
+			double const x = ((double const *)p)[i];
+			if(buf != NULL) { sprintf(buf, "%.17g", x); }
+			*val = x;
+			return(ut_array_key_f64(uint64_t, x));
 		}
-		r++;
+		default: break;
 	}
 
-	if(offset == (uintptr_t)-1LL) {
-		return(NULL);
+	if(type / 16 == UT_ARRAY_SIGNED) {
+		if(buf != NULL) { sprintf(buf, "%" PRId64, s); }
+		*val = (double)s;
+		return(ut_array_key_s(uint64_t, s));
 	}
+	if(buf != NULL) { sprintf(buf, "%" PRIu64, u); }
+	*val = (double)u;
+	return(u);
+}
 
-	#define ut_get_info_call_func(_ptr, _offset) ( \
-		(struct ut_s (*)(void))((uintptr_t)(_ptr) + (uintptr_t)(_offset)) \
-	)
+/**
+ * @fn ut_array_diff
+ * @brief distance of the i-th elements, 0.0 when within the tolerance; the elements
+ * are formatted into bx and by unless they are NULL
+ */
+static inline
+double ut_array_diff(
+	struct ut_array_cmp_s const *c,
+	size_t i,
+	char *bx,
+	char *by)
+{
+	double x = 0.0, y = 0.0;
+	uint64_t const kx = ut_array_elem(c->type, c->a, i, &x, bx);
+	uint64_t const ky = ut_array_elem(c->type, c->b, i, &y, by);
 
-	/* get info */
-	utkvec_t(struct ut_s) buf;
-	
-	r = res;
-	utkv_init(buf);
-	while(r->type != (char)0) {
-		if(ut_startswith(r->name, "ut_get_info_") == 0) {
-			struct ut_s i = ut_get_info_call_func(r->ptr, offset)();
-			utkv_push(buf, i);
-		}
-		r++;
-	}
+	int const nan = (x != x) + (y != y);
+	if(nan != 0) { return(nan == 2 ? 0.0 : __builtin_inf()); }
 
-	/* push terminator */
-	utkv_push(buf, (struct ut_s){ 0 });
-	return(utkv_ptr(buf));
+	if(c->use_abs && c->type / 16 == UT_ARRAY_FLOAT) {
+		double const d = x == y ? 0.0 : __builtin_fabs(x - y);
+		return(d <= c->abs_tol ? 0.0 : d);
+	}
+	uint64_t const d = kx > ky ? kx - ky : ky - kx;
+	return(d <= c->tol ? 0.0 : (double)d);
 }
 
+/**
+ * @fn ut_array_report
+ * @brief the mismatch count, the worst offender, and the first UNITTEST_ARRAY_REPORT_MAX
+ * mismatches; returns a malloc'd string
+ */
 static inline
-struct ut_group_config_s *ut_get_ut_config(
-	struct ut_nm_result_s const *res)
+char *ut_array_report(
+	struct ut_array_cmp_s const *c,
+	size_t cnt)
 {
-	/* extract offset */
-	uintptr_t offset = (uintptr_t)-1LL;
-	struct ut_nm_result_s const *r = res;
-	while(r->type != (char)0) {
-		if(ut_strcmp("main", r->name) == 0) {
-			offset = (uintptr_t)main - (uintptr_t)r->ptr;
-		}
-		r++;
+	char const *unit = c->type / 16 == UT_ARRAY_FLOAT && c->use_abs == 0 ? " ulps" : "";
+	char bx[40], by[40];
+
+	/* locate the worst and the first mismatches from the keys; only those are formatted */
+	size_t first[UNITTEST_ARRAY_REPORT_MAX], listed = 0, worst = 0;
+	double worst_diff = 0.0;
+	for(size_t i = 0; i < c->n; i++) {
+		double const diff = ut_array_diff(c, i, NULL, NULL);
+		if(diff == 0.0) { continue; }
+		if(listed < UNITTEST_ARRAY_REPORT_MAX) { first[listed++] = i; }
+		if(diff > worst_diff) { worst = i; worst_diff = diff; }
 	}
 
-	if(offset == (uintptr_t)-1LL) {
-		return(NULL);
+	char *str = (char *)malloc(256 + (listed + 1) * 128), *s = str;
+	if(c->type / 16 == UT_ARRAY_FLOAT && c->use_abs) {
+		s += sprintf(s, "\n%zu of %zu elements differ (tolerance: %g)", cnt, c->n, c->abs_tol);
+	} else {
+		s += sprintf(s, "\n%zu of %zu elements differ (tolerance: %" PRIu64 "%s)", cnt, c->n, c->tol, unit);
 	}
 
-	#define ut_get_config_call_func(_ptr, _offset) ( \
-		(struct ut_group_config_s (*)(void))((uintptr_t)(_ptr) + (uintptr_t)(_offset)) \
-	)
-
-	/* get info */
-	utkvec_t(struct ut_group_config_s) buf;
-	
-	r = res;
-	utkv_init(buf);
-	while(r->type != (char)0) {
-		if(ut_startswith(r->name, "ut_get_config_") == 0) {
-			struct ut_group_config_s i = ut_get_config_call_func(r->ptr, offset)();
-			utkv_push(buf, i);
-		}
-		r++;
+	ut_array_diff(c, worst, bx, by);
+	s += sprintf(s, ", worst at [%zu]: %s vs %s (diff: %.6g%s)\nfirst mismatches:", worst, bx, by, worst_diff, unit);
+	for(size_t k = 0; k < listed; k++) {
+		double const diff = ut_array_diff(c, first[k], bx, by);
+		s += sprintf(s, "\n  [%zu] %s vs %s (diff: %.6g%s)", first[k], bx, by, diff, unit);
+	}
+	if(cnt > listed) {
+		s += sprintf(s, "\n  ... (%zu more)", cnt - listed);
 	}
+	return(str);
+}
 
-	/* push terminator */
-	utkv_push(buf, (struct ut_group_config_s){ 0 });
-	return(utkv_ptr(buf));
+/**
+ * @macro ut_assert_array_eq, ut_assert_array_near
+ *
+ * @brief compare n elements of the integer or floating-point arrays a and b of the same
+ * type. for floats, an integer tol is a distance in ULPs and a floating-point one an
+ * absolute tolerance; for integers it is the largest absolute difference. on failure
+ * the mismatch count, the worst offender and the first mismatches are printed.
+ */
+#define ut_assert_array_eq(a, b, n) \
+	ut_assert_array_impl(a, b, n, 0, "ut_assert_array_eq(" #a ", " #b ", " #n ")")
+#define ut_assert_array_near(a, b, n, tol) \
+	ut_assert_array_impl(a, b, n, tol, "ut_assert_array_near(" #a ", " #b ", " #n ", " #tol ")")
+
+#define ut_assert_array_impl(_a, _b, _n, _tol, _expr) { \
+	_Static_assert(ut_array_type(_a) == ut_array_type(_b), "element types of `" #_a "' and `" #_b "' differ"); \
+	double const _ut_tol = (double)(_tol); \
+	struct ut_array_cmp_s const _ut_cmp = { \
+		.type = ut_array_type(_a), \
+		.use_abs = _Generic((_tol), float: 1, double: 1, long double: 1, default: 0), \
+		.a = (_a), .b = (_b), \
+		.n = (size_t)(_n), \
+		.tol = _ut_tol <= 0.0 ? 0 : (uint64_t)_ut_tol, \
+		.abs_tol = _ut_tol \
+	}; \
+	size_t const _ut_cnt = ut_array_count(&_ut_cmp); \
+	if(__builtin_expect(_ut_cnt == 0, 1)) { \
+		ut_assert_succ(); \
+	} else { \
+		ut_info->fail++; \
+		char *_ut_str = ut_array_report(&_ut_cmp, _ut_cnt); \
+		ut_gconf->printer.failed(ut_info, ut_gconf, ut_config, __LINE__, __func__, _expr, "%s", _ut_str); \
+		free(_ut_str); \
+	} \
 }
 
+/**
+ * @fn ut_hash_bytes
+ * @brief 64-bit multiplicative hash, chained through h
+ */
 static inline
-void ut_dump_test(
-	struct ut_s const *test)
+uint64_t ut_hash_bytes(
+	uint64_t h,
+	void const *ptr,
+	size_t len)
 {
-	struct ut_s const *t = test;
-	while(t->file != NULL) {
-		printf("%s, %zu, %zu, %s, %s, %p, %p\n",
-			t->file,
-			t->line,
-			t->unique_id,
-			t->name,
-			t->depends_on[0],
-			(void *)t->init,
+	uint8_t const *p = (uint8_t const *)ptr;
+	for(; len >= 8; len -= 8, p += 8) {
+		uint64_t w;
+		memcpy(&w, p, sizeof(uint64_t));
+		h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+		h ^= h>>29;
+	}
+	for(; len > 0; len--) {
+		h = (h ^ *p++) * 0x100000001b3ULL;
+	}
+	return(h ^ (h>>32));
+}
+
+#ifndef UNITTEST_DIFF_CONTEXT
+#define UNITTEST_DIFF_CONTEXT		( 3 )		/* unchanged lines around each hunk */
+#endif
+#ifndef UNITTEST_DIFF_MAX_COST
+#define UNITTEST_DIFF_MAX_COST		( 1024 )	/* edits searched per split before settling for a suboptimal one */
+#endif
+#ifndef UNITTEST_DIFF_MAX_LINES
+#define UNITTEST_DIFF_MAX_LINES		( 200 )		/* diff lines printed */
+#endif
+#ifndef UNITTEST_DIFF_LINE_WIDTH
+#define UNITTEST_DIFF_LINE_WIDTH	( 256 )		/* bytes printed per line */
+#endif
+
+/**
+ * @struct ut_diff_s
+ * @brief line diff of two texts for ut_assert_str_eq. lines are interned to ids so
+ * that the edit search compares integers; changed[s][i] is set for the lines
+ * removed from (s = 0) or added to (s = 1) the text.
+ */
+struct ut_diff_s {
+	char const *text[2];
+	size_t cnt[2];
+	size_t *head[2];		/* line i is text[head[i]] .. text[head[i + 1] - 1], including the newline */
+	uint32_t *id[2];
+	uint8_t *changed[2];
+	int64_t *fd, *bd;		/* furthest x reached by the forward / backward searches, indexed by diagonal x - y */
+};
+
+static inline
+size_t *ut_diff_split_lines(
+	char const *text,
+	size_t len,
+	size_t *cnt)
+{
+	char const *const t = text + len;
+	size_t nl = 0;
+	for(char const *p = text; (p = (char const *)memchr(p, '\n', t - p)) != NULL; p++) { nl++; }
+
+	/* the last line may lack the newline */
+	*cnt = nl + (len > 0 && t[-1] != '\n');
+	size_t *head = (size_t *)malloc(sizeof(size_t) * (*cnt + 2)), k = 0;
+	head[0] = 0;
+	for(char const *p = text; (p = (char const *)memchr(p, '\n', t - p)) != NULL; p++) { head[++k] = p - text + 1; }
+	head[*cnt] = len;
+	return(head);
+}
+
+/**
+ * @fn ut_diff_intern
+ * @brief assign the index of the first occurrence (over both texts) to each line
+ */
+static inline
+void ut_diff_intern(
+	struct ut_diff_s *d)
+{
+	size_t const total = d->cnt[0] + d->cnt[1];
+	size_t size = 2 * total + 1;
+	utkv_roundup32(size);
+
+	size_t const mask = size - 1;
+	size_t *slot = (size_t *)calloc(size, sizeof(size_t));		/* (representative) + 1, 0 when empty */
+
+	for(size_t s = 0; s < 2; s++) {
+		for(size_t i = 0; i < d->cnt[s]; i++) {
+			char const *p = d->text[s] + d->head[s][i];
+			size_t const len = d->head[s][i + 1] - d->head[s][i];
+
+			size_t h = ut_hash_bytes(len, p, len) & mask;
+			while(slot[h] != 0) {
+				size_t const r = slot[h] - 1, rs = r >= d->cnt[0], ri = r - rs * d->cnt[0];
+				char const *q = d->text[rs] + d->head[rs][ri];
+				if(d->head[rs][ri + 1] - d->head[rs][ri] == len && memcmp(p, q, len) == 0) { break; }
+				h = (h + 1) & mask;
+			}
+			if(slot[h] == 0) { slot[h] = s * d->cnt[0] + i + 1; }
+			d->id[s][i] = (uint32_t)(slot[h] - 1);
+		}
+	}
+	free(slot);
+	return;
+}
+
+/**
+ * @fn ut_diff_split
+ * @brief find the middle snake of a[xoff, xlim) and b[yoff, ylim) by searching from
+ * both corners (Myers, linear space). after UNITTEST_DIFF_MAX_COST edits the
+ * furthest reaching point is taken instead, as in GNU diff.
+ */
+static inline
+void ut_diff_split(
+	struct ut_diff_s *d,
+	int64_t xoff,
+	int64_t xlim,
+	int64_t yoff,
+	int64_t ylim,
+	int64_t *xmid,
+	int64_t *ymid)
+{
+	uint32_t const *a = d->id[0], *b = d->id[1];
+	int64_t *const fd = d->fd, *const bd = d->bd;
+	int64_t const dmin = xoff - ylim, dmax = xlim - yoff;
+	int64_t const fmid = xoff - yoff, bmid = xlim - ylim;
+	int64_t fmin = fmid, fmax = fmid, bmin = bmid, bmax = bmid;
+	int const odd = (fmid - bmid) & 1;
+
+	fd[fmid] = xoff;
+	bd[bmid] = xlim;
+	for(int64_t c = 1;; c++) {
+		/* forward, one more edit */
+		if(fmin > dmin) { fd[--fmin - 1] = -1; } else { fmin++; }
+		if(fmax < dmax) { fd[++fmax + 1] = -1; } else { fmax--; }
+		for(int64_t k = fmax; k >= fmin; k -= 2) {
+			int64_t x = fd[k - 1] >= fd[k + 1] ? fd[k - 1] + 1 : fd[k + 1], y = x - k;
+			while(x < xlim && y < ylim && a[x] == b[y]) { x++; y++; }
+			fd[k] = x;
+			if(odd && bmin <= k && k <= bmax && bd[k] <= x) { *xmid = x; *ymid = y; return; }
+		}
+
+		/* backward */
+		if(bmin > dmin) { bd[--bmin - 1] = INT64_MAX; } else { bmin++; }
+		if(bmax < dmax) { bd[++bmax + 1] = INT64_MAX; } else { bmax--; }
+		for(int64_t k = bmax; k >= bmin; k -= 2) {
+			int64_t x = bd[k - 1] < bd[k + 1] ? bd[k - 1] : bd[k + 1] - 1, y = x - k;
+			while(x > xoff && y > yoff && a[x - 1] == b[y - 1]) { x--; y--; }
+			bd[k] = x;
+			if(!odd && fmin <= k && k <= fmax && x <= fd[k]) { *xmid = x; *ymid = y; return; }
+		}
+		if(c < UNITTEST_DIFF_MAX_COST) { continue; }
+
+		/* too expensive; split at the point that got furthest from its corner */
+		int64_t fxy = -1, fx = xoff, bxy = INT64_MAX, bx = xlim;
+		for(int64_t k = fmax; k >= fmin; k -= 2) {
+			int64_t x = fd[k] < xlim ? fd[k] : xlim, y = x - k;
+			if(y > ylim) { x = ylim + k; y = ylim; }
+			if(x + y > fxy) { fxy = x + y; fx = x; }
+		}
+		for(int64_t k = bmax; k >= bmin; k -= 2) {
+			int64_t x = bd[k] > xoff ? bd[k] : xoff, y = x - k;
+			if(y < yoff) { x = yoff + k; y = yoff; }
+			if(x + y < bxy) { bxy = x + y; bx = x; }
+		}
+		if((xlim + ylim) - bxy < fxy - (xoff + yoff)) {
+			*xmid = fx; *ymid = fxy - fx;
+		} else {
+			*xmid = bx; *ymid = bxy - bx;
+		}
+		return;
+	}
+}
+
+/**
+ * @fn ut_diff_compare
+ * @brief mark the changed lines of a[xoff, xlim) and b[yoff, ylim)
+ */
+static
+void ut_diff_compare(
+	struct ut_diff_s *d,
+	int64_t xoff,
+	int64_t xlim,
+	int64_t yoff,
+	int64_t ylim)
+{
+	uint32_t const *a = d->id[0], *b = d->id[1];
+	while(1) {
+		/* trim the common prefix and suffix */
+		while(xoff < xlim && yoff < ylim && a[xoff] == b[yoff]) { xoff++; yoff++; }
+		while(xoff < xlim && yoff < ylim && a[xlim - 1] == b[ylim - 1]) { xlim--; ylim--; }
+
+		if(xoff == xlim || yoff == ylim) {
+			memset(&d->changed[0][xoff], 1, xlim - xoff);
+			memset(&d->changed[1][yoff], 1, ylim - yoff);
+			return;
+		}
+
+		/* recurse on the first half, loop on the second */
+		int64_t xmid, ymid;
+		ut_diff_split(d, xoff, xlim, yoff, ylim, &xmid, &ymid);
+		ut_diff_compare(d, xoff, xmid, yoff, ymid);
+		xoff = xmid;
+		yoff = ymid;
+	}
+}
+
+static inline
+void ut_diff_print_line(
+	struct ut_strbuf_s *sb,
+	size_t *printed,
+	char mark,
+	struct ut_diff_s const *d,
+	size_t s,
+	size_t i)
+{
+	if((*printed)++ >= UNITTEST_DIFF_MAX_LINES) { return; }
+
+	char const *p = d->text[s] + d->head[s][i];
+	size_t len = d->head[s][i + 1] - d->head[s][i];
+	int const nl = p[len - 1] == '\n';
+	len -= nl;
+	if(len > UNITTEST_DIFF_LINE_WIDTH) {
+		ut_strbuf_printf(sb, "\n%c%.*s... (%zu more bytes)", mark, UNITTEST_DIFF_LINE_WIDTH, p, len - UNITTEST_DIFF_LINE_WIDTH);
+	} else {
+		ut_strbuf_printf(sb, "\n%c%.*s", mark, (int)len, p);
+	}
+	if(!nl) { ut_strbuf_printf(sb, "\n\\ No newline at end of text"); }
+	return;
+}
+
+/**
+ * @fn ut_diff_hunks
+ * @brief print the changes as unified-diff hunks; returns the number of hunks
+ */
+static inline
+size_t ut_diff_hunks(
+	struct ut_strbuf_s *sb,
+	size_t *printed,
+	struct ut_diff_s const *d)
+{
+	size_t const na = d->cnt[0], nb = d->cnt[1], ctx = UNITTEST_DIFF_CONTEXT;
+	uint8_t const *ca = d->changed[0], *cb = d->changed[1];
+	size_t i = 0, j = 0, last = 0, hunks = 0;
+
+	while(1) {
+		/* unchanged lines advance in lockstep */
+		while(i < na && j < nb && !ca[i] && !cb[j]) { i++; j++; }
+		if(i == na && j == nb) { break; }
+
+		/* merge changes separated by at most 2 * ctx unchanged lines */
+		size_t const back = i - last < ctx ? i - last : ctx;
+		size_t const i0 = i - back, j0 = j - back;
+		size_t run;
+		while(1) {
+			while(i < na && ca[i]) { i++; }
+			while(j < nb && cb[j]) { j++; }
+			for(run = 0; run <= 2 * ctx && i + run < na && j + run < nb && !ca[i + run] && !cb[j + run]; run++) {}
+			if(run > 2 * ctx || (i + run == na && j + run == nb)) { break; }
+			i += run;
+			j += run;
+		}
+		size_t const ie = i + (run < ctx ? run : ctx), je = j + (run < ctx ? run : ctx);
+
+		if((*printed)++ < UNITTEST_DIFF_MAX_LINES) {
+			ut_strbuf_printf(sb, "\n@@ -%zu,%zu +%zu,%zu @@",
+				i0 + (ie > i0), ie - i0, j0 + (je > j0), je - j0);
+		}
+		for(size_t x = i0, y = j0; x < ie || y < je;) {
+			while(x < ie && ca[x]) { ut_diff_print_line(sb, printed, '-', d, 0, x++); }
+			while(y < je && cb[y]) { ut_diff_print_line(sb, printed, '+', d, 1, y++); }
+			if(x < ie && y < je && !ca[x] && !cb[y]) { ut_diff_print_line(sb, printed, ' ', d, 0, x); x++; y++; }
+		}
+		last = i;
+		hunks++;
+	}
+	return(hunks);
+}
+
+/**
+ * @fn ut_text_diff
+ * @brief append the line diff of a[0, la) and b[0, lb) to sb
+ */
+static inline
+void ut_text_diff(
+	struct ut_strbuf_s *sb,
+	char const *a,
+	size_t la,
+	char const *b,
+	size_t lb,
+	char const *name_a,
+	char const *name_b)
+{
+	struct ut_diff_s d = { .text = { a, b } };
+	size_t const pos = ut_mem_find_diff((uint8_t const *)a, (uint8_t const *)b, la < lb ? la : lb);
+	d.head[0] = ut_diff_split_lines(a, la, &d.cnt[0]);
+	d.head[1] = ut_diff_split_lines(b, lb, &d.cnt[1]);
+	for(size_t s = 0; s < 2; s++) {
+		d.id[s] = (uint32_t *)malloc(sizeof(uint32_t) * (d.cnt[s] + 1));
+		d.changed[s] = (uint8_t *)calloc(d.cnt[s] + 1, sizeof(uint8_t));
+	}
+	ut_diff_intern(&d);
+
+	/* diagonals range over [-cnt[1] - 1, cnt[0] + 1] */
+	int64_t *diag = (int64_t *)malloc(sizeof(int64_t) * 2 * (d.cnt[0] + d.cnt[1] + 3));
+	d.fd = diag + d.cnt[1] + 1;
+	d.bd = d.fd + d.cnt[0] + d.cnt[1] + 3;
+	ut_diff_compare(&d, 0, d.cnt[0], 0, d.cnt[1]);
+
+	/* header */
+	size_t removed = 0, added = 0, line = 1, col = pos;
+	for(size_t i = 0; i < d.cnt[0]; i++) { removed += d.changed[0][i]; }
+	for(size_t i = 0; i < d.cnt[1]; i++) { added += d.changed[1][i]; }
+	for(char const *p = a; (p = (char const *)memchr(p, '\n', a + pos - p)) != NULL; p++) { line++; col = a + pos - p - 1; }
+	ut_strbuf_printf(sb, "\n`%s' vs `%s' lines: %zu, %zu, first differ at line %zu, column %zu; %zu removed, %zu added",
+		name_a, name_b, d.cnt[0], d.cnt[1], line, col + 1, removed, added);
+	ut_strbuf_printf(sb, "\n--- %s\n+++ %s", name_a, name_b);
+
+	size_t printed = 0;
+	size_t const hunks = ut_diff_hunks(sb, &printed, &d);
+	if(printed > UNITTEST_DIFF_MAX_LINES) {
+		ut_strbuf_printf(sb, "\n... (%zu more diff lines, %zu hunk%s in total)",
+			printed - UNITTEST_DIFF_MAX_LINES, hunks, hunks == 1 ? "" : "s");
+	}
+
+	/* cleanup */
+	free(diag);
+	for(size_t s = 0; s < 2; s++) {
+		free(d.head[s]);
+		free(d.id[s]);
+		free(d.changed[s]);
+	}
+	return;
+}
+
+/**
+ * @fn ut_str_diff
+ * @brief line diff of two different strings; returns a malloc'd string
+ */
+static inline
+char *ut_str_diff(
+	char const *a,
+	char const *b,
+	char const *name_a,
+	char const *name_b)
+{
+	struct ut_strbuf_s sb = { 0 };
+	if(a == NULL || b == NULL) {
+		ut_strbuf_printf(&sb, "\n`%s' is NULL", a == NULL ? name_a : name_b);
+	} else {
+		ut_text_diff(&sb, a, strlen(a), b, strlen(b), name_a, name_b);
+	}
+	return(utkv_ptr(sb));
+}
+
+static inline
+int ut_str_eq(
+	char const *a,
+	char const *b)
+{
+	if(a == NULL || b == NULL) { return(a == b); }
+	size_t const la = strlen(a);
+	return(la == strlen(b) && memcmp(a, b, la) == 0);
+}
+
+/**
+ * @macro ut_assert_str_eq
+ *
+ * @brief assert that the strings a and b are the same. on failure, the lines that
+ * differ are printed as unified-diff hunks, up to UNITTEST_DIFF_MAX_LINES lines.
+ */
+#define ut_assert_str_eq(a, b) { \
+	char const *_ut_a = (a), *_ut_b = (b); \
+	if(__builtin_expect(ut_str_eq(_ut_a, _ut_b), 1)) { \
+		ut_assert_succ(); \
+	} else { \
+		ut_info->fail++; \
+		char *_ut_str = ut_str_diff(_ut_a, _ut_b, #a, #b); \
+		ut_gconf->printer.failed(ut_info, ut_gconf, ut_config, __LINE__, __func__, \
+			"ut_assert_str_eq(" #a ", " #b ")", "%s", _ut_str); \
+		free(_ut_str); \
+	} \
+}
+
+/**
+ * @fn ut_xxh64
+ * @brief XXH64 of xxHash (https://github.com/Cyan4973/xxHash), little-endian loads
+ */
+#define UT_XXH_P1		( 0x9e3779b185ebca87ULL )
+#define UT_XXH_P2		( 0xc2b2ae3d27d4eb4fULL )
+#define UT_XXH_P3		( 0x165667b19e3779f9ULL )
+#define UT_XXH_P4		( 0x85ebca77c2b2ae63ULL )
+#define UT_XXH_P5		( 0x27d4eb2f165667c5ULL )
+#define ut_xxh_rotl(_x, _r)	( ((_x)<<(_r)) | ((_x)>>(64 - (_r))) )
+
+static inline
+uint64_t ut_xxh_round(
+	uint64_t acc,
+	uint8_t const *p)
+{
+	uint64_t w;
+	memcpy(&w, p, sizeof(uint64_t));
+	acc += w * UT_XXH_P2;
+	return(ut_xxh_rotl(acc, 31) * UT_XXH_P1);
+}
+
+static inline
+uint64_t ut_xxh64(
+	void const *ptr,
+	size_t len,
+	uint64_t seed)
+{
+	uint8_t const *p = (uint8_t const *)ptr, *const t = p + len;
+	uint64_t h;
+
+	if(len >= 32) {
+		uint64_t v[4] = { seed + UT_XXH_P1 + UT_XXH_P2, seed + UT_XXH_P2, seed, seed - UT_XXH_P1 };
+		for(; t - p >= 32; p += 32) {
+			for(size_t k = 0; k < 4; k++) { v[k] = ut_xxh_round(v[k], p + 8 * k); }
+		}
+		h = ut_xxh_rotl(v[0], 1) + ut_xxh_rotl(v[1], 7) + ut_xxh_rotl(v[2], 12) + ut_xxh_rotl(v[3], 18);
+		for(size_t k = 0; k < 4; k++) {
+			uint64_t const r = ut_xxh_rotl(v[k] * UT_XXH_P2, 31) * UT_XXH_P1;
+			h = (h ^ r) * UT_XXH_P1 + UT_XXH_P4;
+		}
+	} else {
+		h = seed + UT_XXH_P5;
+	}
+	h += len;
+
+	/* tail */
+	for(; t - p >= 8; p += 8) {
+		h ^= ut_xxh_round(0, p);
+		h = ut_xxh_rotl(h, 27) * UT_XXH_P1 + UT_XXH_P4;
+	}
+	if(t - p >= 4) {
+		uint32_t w;
+		memcpy(&w, p, sizeof(uint32_t));
+		h ^= (uint64_t)w * UT_XXH_P1;
+		h = ut_xxh_rotl(h, 23) * UT_XXH_P2 + UT_XXH_P3;
+		p += 4;
+	}
+	for(; p < t; p++) {
+		h ^= *p * UT_XXH_P5;
+		h = ut_xxh_rotl(h, 11) * UT_XXH_P1;
+	}
+
+	/* avalanche */
+	h ^= h>>33; h *= UT_XXH_P2;
+	h ^= h>>29; h *= UT_XXH_P3;
+	h ^= h>>32;
+	return(h);
+}
+
+#ifndef UNITTEST_SNAPSHOT_DIR
+#define UNITTEST_SNAPSHOT_DIR		"snapshots"		/* default of --snapshot-dir */
+#endif
+
+/* st_mtime is an alias of st_mtim.tv_sec where the nanosecond field is declared (glibc, musl, BSDs) */
+#if defined(__APPLE__)
+#  define ut_mtime_ns(_st)		( (int64_t)(_st).st_mtimespec.tv_sec * 1000000000 + (_st).st_mtimespec.tv_nsec )
+#elif defined(st_mtime)
+#  define ut_mtime_ns(_st)		( (int64_t)(_st).st_mtim.tv_sec * 1000000000 + (_st).st_mtim.tv_nsec )
+#else
+#  define ut_mtime_ns(_st)		( (int64_t)(_st).st_mtime * 1000000000 )
+#endif
+
+/**
+ * @fn ut_snapshot_load_hash
+ * @brief the hash recorded in the sidecar of the golden file, or 0 when the sidecar
+ * is missing or was recorded for another size or mtime of the golden file
+ */
+static inline
+uint64_t ut_snapshot_load_hash(
+	char const *sidecar,
+	struct stat const *st)
+{
+	FILE *fp = fopen(sidecar, "r");
+	if(fp == NULL) { return(0); }
+
+	uint64_t hash = 0, size = 0;
+	int64_t mtime = 0;
+	int const n = fscanf(fp, "%" SCNx64 "\t%" SCNu64 "\t%" SCNd64, &hash, &size, &mtime);
+	fclose(fp);
+
+	if(n != 3 || size != (uint64_t)st->st_size || mtime != ut_mtime_ns(*st)) { return(0); }
+	return(hash);
+}
+
+/**
+ * @fn ut_write_file
+ * @brief replace the file atomically (temporary file and rename), creating the parent directories
+ */
+static inline
+int ut_write_file(
+	char const *filename,
+	void const *buf,
+	size_t len)
+{
+	static size_t cnt = 0;
+	size_t const flen = strlen(filename);
+	char tmp[flen + 48];
+	snprintf(tmp, flen + 48, "%s.tmp.%ld.%zu", filename, (long)getpid(), __atomic_fetch_add(&cnt, 1, __ATOMIC_RELAXED));
+
+	/* mkdir -p */
+	for(char *p = tmp + 1; (p = strchr(p, '/')) != NULL; p++) {
+		*p = '\0';
+		mkdir(tmp, 0755);
+		*p = '/';
+	}
+
+	FILE *fp = fopen(tmp, "wb");
+	if(fp == NULL) { return(-1); }
+	size_t const written = fwrite(buf, 1, len, fp);
+	if(fclose(fp) != 0 || written != len || rename(tmp, filename) != 0) {
+		remove(tmp);
+		return(-1);
+	}
+	return(0);
+}
+
+/**
+ * @fn ut_snapshot_update
+ * @brief write the golden file (when buf is not NULL) and its sidecar
+ */
+static inline
+int ut_snapshot_update(
+	char const *path,
+	char const *sidecar,
+	void const *buf,
+	size_t len,
+	uint64_t hash)
+{
+	struct stat st;
+	if((buf != NULL && ut_write_file(path, buf, len) != 0) || stat(path, &st) != 0) { return(-1); }
+
+	char line[64];
+	int const n = snprintf(line, 64, "%016" PRIx64 "\t%" PRIu64 "\t%" PRId64 "\n",
+		hash, (uint64_t)st.st_size, ut_mtime_ns(st));
+	return(ut_write_file(sidecar, line, n));
+}
+
+/**
+ * @fn ut_snapshot_check
+ * @brief compare buf with the golden file `dir/name'; returns NULL when they are the same,
+ * or a malloc'd message. the golden file is not read when the size and the hash of buf
+ * match its sidecar (`dir/name.xxh64', a cache valid for the size and mtime of the golden
+ * file); otherwise it is mapped and compared bytewise, and the sidecar is refreshed.
+ * with --update-snapshots, missing or different golden files are (re)written instead.
+ */
+static inline
+char *ut_snapshot_check(
+	struct ut_global_config_s const *gconf,
+	char const *name,
+	void const *buf,
+	size_t len,
+	char const *name_buf)
+{
+	char const *dir = gconf->snapshot_dir != NULL ? gconf->snapshot_dir : UNITTEST_SNAPSHOT_DIR;
+	size_t const size = strlen(dir) + strlen(name) + 16;
+	char path[size], sidecar[size];
+	snprintf(path, size, "%s/%s", dir, name);
+	snprintf(sidecar, size, "%s.xxh64", path);
+
+	/* fast path */
+	uint64_t const hash = ut_xxh64(buf, len, 0);
+	struct stat st;
+	int const found = stat(path, &st) == 0;
+	if(found && (size_t)st.st_size == len) {
+		uint64_t const recorded = ut_snapshot_load_hash(sidecar, &st);
+		if(recorded != 0 && recorded == hash) { return(NULL); }
+	}
+
+	/* map and compare */
+	int const fd = found ? open(path, O_RDONLY) : -1;
+	size_t const glen = fd >= 0 ? (size_t)st.st_size : 0;
+	void *base = glen > 0 ? mmap(NULL, glen, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+	if(fd >= 0) { close(fd); }
+
+	int const mapped = fd >= 0 && base != MAP_FAILED;
+	uint8_t const *golden = mapped && base != NULL ? (uint8_t const *)base : (uint8_t const *)"";
+	#if defined(MADV_SEQUENTIAL)
+		if(golden == base) { madvise(base, glen, MADV_SEQUENTIAL); }
+	#endif
+	int const same = mapped && glen == len && ut_mem_find_diff(golden, (uint8_t const *)buf, len) == len;
+
+	char *str = NULL;
+	if(same) {
+		/* the sidecar is stale or missing; refresh it (best effort, e.g. on a read-only checkout) */
+		ut_snapshot_update(path, sidecar, NULL, len, hash);
+	} else if(gconf->update_snapshots) {
+		if(ut_snapshot_update(path, sidecar, buf, len, hash) == 0) {
+			/* stderr, not gconf->fp: the report stream is ordered (and json with -j) */
+			fprintf(stderr, ut_color(UT_YELLOW, "snapshot updated") ": %s (%zu bytes)\n", path, len);
+		} else {
+			str = (char *)malloc(size + 64);
+			sprintf(str, "\nfailed to write golden file `%s'", path);
+		}
+	} else {
+		struct ut_strbuf_s sb = { 0 };
+		if(!mapped) {
+			ut_strbuf_printf(&sb, found ? "\nfailed to map golden file `%s'" : "\ngolden file `%s' not found (run with --update-snapshots to create it)", path);
+		} else if(memchr(golden, '\0', glen) == NULL && memchr(buf, '\0', len) == NULL) {
+			ut_text_diff(&sb, (char const *)golden, glen, (char const *)buf, len, path, name_buf);
+		} else {
+			size_t const min = len < glen ? len : glen;
+			size_t const pos = ut_mem_find_diff(golden, (uint8_t const *)buf, min);
+			if(pos < min) {
+				char *w = ut_mem_diff_window(golden, (uint8_t const *)buf, min, pos, path, name_buf);
+				ut_strbuf_printf(&sb, "%s", w);
+				free(w);
+			}
+			if(len != glen) {
+				ut_strbuf_printf(&sb, "\n`%s' is %zu bytes while golden file `%s' is %zu", name_buf, len, path, glen);
+			}
+		}
+		str = utkv_ptr(sb);
+	}
+
+	if(golden == base) { munmap(base, glen); }
+	return(str);
+}
+
+/**
+ * @macro ut_assert_snapshot
+ *
+ * @brief assert that len bytes at buf are the same as the golden file `name' in the
+ * snapshot directory (--snapshot-dir). run with --update-snapshots to (re)create them.
+ */
+#define ut_assert_snapshot(name, buf, len) { \
+	char *_ut_str = ut_snapshot_check(ut_gconf, (name), (void const *)(buf), (size_t)(len), #buf); \
+	if(__builtin_expect(_ut_str == NULL, 1)) { \
+		ut_assert_succ(); \
+	} else { \
+		ut_info->fail++; \
+		ut_gconf->printer.failed(ut_info, ut_gconf, ut_config, __LINE__, __func__, \
+			"ut_assert_snapshot(" #name ", " #buf ", " #len ")", "%s", _ut_str); \
+		free(_ut_str); \
+	} \
+}
+
+/**
+ * @struct ut_fixture_s
+ * @brief read-only view of a file mapped by ut_fixture_map, shared by all the tests and threads
+ */
+struct ut_fixture_s {
+	void const *ptr;
+	size_t size;
+	char const *path;
+
+	/* internal use */
+	dev_t dev;
+	ino_t ino;
+	size_t ref;
+	struct ut_fixture_s *next;
+};
+
+/**
+ * @struct ut_fixture_cache_s
+ * @brief mapped files of the process, keyed by (device, inode). defined weak so that
+ * all the translation units including this header share one instance.
+ */
+struct ut_fixture_cache_s {
+	pthread_mutex_t lock;
+	struct ut_fixture_s *head;
+};
+struct ut_fixture_cache_s ut_fixture_cache __attribute__(( weak )) = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/**
+ * @fn ut_fixture_map
+ * @brief map the file read-only, or take another reference to the mapping made earlier
+ * in the process; returns NULL on failure. release with ut_fixture_unmap.
+ */
+static inline
+struct ut_fixture_s const *ut_fixture_map(
+	char const *path)
+{
+	struct stat st;
+	int const fd = open(path, O_RDONLY);
+	if(fd < 0 || fstat(fd, &st) != 0) {
+		fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": failed to open fixture `%s' (%s).\n", path, strerror(errno));
+		if(fd >= 0) { close(fd); }
+		return(NULL);
+	}
+
+	pthread_mutex_lock(&ut_fixture_cache.lock);
+	struct ut_fixture_s *f = ut_fixture_cache.head;
+	while(f != NULL && (f->dev != st.st_dev || f->ino != st.st_ino)) { f = f->next; }
+
+	if(f != NULL) {
+		f->ref++;
+	} else {
+		size_t const size = (size_t)st.st_size;
+		void *base = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+		if(base != MAP_FAILED) {
+			#if defined(MADV_WILLNEED)
+				if(base != NULL) { madvise(base, size, MADV_WILLNEED); }
+			#endif
+			/* path is copied right after the struct */
+			size_t const plen = strlen(path);
+			f = (struct ut_fixture_s *)malloc(sizeof(struct ut_fixture_s) + plen + 1);
+			memcpy((char *)(f + 1), path, plen + 1);
+			*f = (struct ut_fixture_s){
+				.ptr = base != NULL ? base : (void const *)"",
+				.size = size,
+				.path = (char const *)(f + 1),
+				.dev = st.st_dev,
+				.ino = st.st_ino,
+				.ref = 1,
+				.next = ut_fixture_cache.head
+			};
+			ut_fixture_cache.head = f;
+		} else {
+			fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": failed to map fixture `%s' (%s).\n", path, strerror(errno));
+		}
+	}
+	pthread_mutex_unlock(&ut_fixture_cache.lock);
+
+	close(fd);
+	return(f);
+}
+
+/**
+ * @fn ut_fixture_unmap
+ * @brief drop a reference; the file is unmapped with the last one
+ */
+static inline
+void ut_fixture_unmap(
+	struct ut_fixture_s const *fixture)
+{
+	if(fixture == NULL) { return; }
+
+	pthread_mutex_lock(&ut_fixture_cache.lock);
+	for(struct ut_fixture_s **p = &ut_fixture_cache.head; *p != NULL; p = &(*p)->next) {
+		struct ut_fixture_s *f = *p;
+		if(f != fixture) { continue; }
+		if(--f->ref == 0) {
+			*p = f->next;
+			if(f->size > 0) { munmap((void *)f->ptr, f->size); }
+			free(f);
+		}
+		break;
+	}
+	pthread_mutex_unlock(&ut_fixture_cache.lock);
+	return;
+}
+
+/**
+ * @fn ut_fixture_init, ut_fixture_clean
+ * @brief group init / clean mapping the file named by params. the tests receive the
+ * struct ut_fixture_s const * as gctx, and the file stays mapped while any group
+ * using it is running:
+ *
+ *   unittest_config(.init = ut_fixture_init, .clean = ut_fixture_clean, .params = "ref.bin");
+ */
+static inline
+void *ut_fixture_init(
+	void *params)
+{
+	return((void *)ut_fixture_map((char const *)params));
+}
+
+static inline
+void ut_fixture_clean(
+	void *context)
+{
+	ut_fixture_unmap((struct ut_fixture_s const *)context);
+	return;
+}
+
+/**
+ * @struct ut_nm_result_s
+ * @brief discovered symbol; name points into the symbol table image (not copied)
+ */
+struct ut_nm_result_s {
+	void *ptr;
+	char type;				/* UT_NM_INFO or UT_NM_CONFIG, 0 for the terminator */
+	char const *name;
+};
+
+#define UT_NM_INFO			( 'i' )
+#define UT_NM_CONFIG		( 'c' )
+
+/**
+ * @struct ut_nm_s
+ * @brief symbol table of the executable and its load offset
+ */
+struct ut_nm_s {
+	uintptr_t offset;		/* (runtime address) - (address in the symbol table) */
+	struct ut_nm_result_s *res;
+
+	/* backing storage of the names */
+	void *base;
+	size_t size;
+	int mapped;				/* 1 when base is mmapped image, 0 when malloc'd nm output */
+	char const *err;		/* why the in-process reader failed; reported only if nm fails too */
+};
+
+static inline
+int ut_strcmp(
+	char const *a,
+	char const *b)
+{
+	/* if both are NULL */
+	if(a == NULL && b == NULL) {
+		return(0);
+	}
+
+	if(b == NULL) {
+		return(1);
+	}
+	if(a == NULL) {
+		return(-1);
+	}
+	return(strcmp(a, b));
+}
+
+static inline
+int ut_startswith(char const *str, char const *prefix)
+{
+	while(*str != '\0' && *prefix != '\0') {
+		if(*str++ != *prefix++) { return(1); }
+	}
+	return(*prefix == '\0' ? 0 : 1);
+}
+
+/**
+ * @fn ut_nm_classify
+ * @brief returns symbol class (UT_NM_INFO, UT_NM_CONFIG), 'm' for main, and 0 for the others
+ */
+static inline
+char ut_nm_classify(
+	char const *name)
+{
+	/* reject most symbols with the first two characters */
+	if(name[0] == 'm') {
+		return(strcmp(name, "main") == 0 ? 'm' : 0);
+	}
+	if(name[0] != 'u' || name[1] != 't' || ut_startswith(name, "ut_get_") != 0) {
+		return(0);
+	}
+	if(ut_startswith(name + strlen("ut_get_"), "info_") == 0) {
+		return(UT_NM_INFO);
+	}
+	if(ut_startswith(name + strlen("ut_get_"), "config_") == 0) {
+		return(UT_NM_CONFIG);
+	}
+	return(0);
+}
+
+#if defined(__ELF__)
+/**
+ * in-process ELF symbol table reader; the executable is mapped read-only and
+ * .symtab (or .dynsym when stripped) is scanned once.
+ */
+#if UINTPTR_MAX > 0xffffffffu
+#  define ut_elf(x)			Elf64_##x
+#  define UT_ELF_CLASS		ELFCLASS64
+#  define ut_elf_st_type(i)	ELF64_ST_TYPE(i)
+#else
+#  define ut_elf(x)			Elf32_##x
+#  define UT_ELF_CLASS		ELFCLASS32
+#  define ut_elf_st_type(i)	ELF32_ST_TYPE(i)
+#endif
+
+static inline
+int ut_nm_map_file(
+	struct ut_nm_s *nm,
+	char const *filename)
+{
+	int fd = -1;
+	struct stat st;
+
+	/* /proc/self/exe is always the running image; argv[0] is a fallback for the other unices */
+	if((fd = open("/proc/self/exe", O_RDONLY)) < 0 && (fd = open(filename, O_RDONLY)) < 0) {
+		nm->err = "failed to open the executable";
+		return(-1);
+	}
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ut_elf(Ehdr))) {
+		nm->err = "failed to stat the executable";
+		close(fd);
+		return(-1);
+	}
+
+	void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(base == MAP_FAILED) {
+		nm->err = "failed to map the executable";
+		return(-1);
+	}
+
+	nm->base = base;
+	nm->size = (size_t)st.st_size;
+	nm->mapped = 1;
+	return(0);
+}
+
+/**
+ * @struct ut_elf_symtab_s
+ * @brief symbol and string tables in the mapped image
+ */
+struct ut_elf_symtab_s {
+	ut_elf(Sym) const *sym;
+	size_t sym_cnt;
+	char const *strtab;
+	size_t strtab_size;
+};
+
+static inline
+int ut_elf_find_symtab(
+	struct ut_nm_s *nm,
+	struct ut_elf_symtab_s *tab)
+{
+	uint8_t const *base = (uint8_t const *)nm->base;
+	ut_elf(Ehdr) const *eh = (ut_elf(Ehdr) const *)base;
+
+	/* sanity check */
+	if(memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 || eh->e_ident[EI_CLASS] != UT_ELF_CLASS
+	|| eh->e_shoff == 0 || eh->e_shentsize != sizeof(ut_elf(Shdr))
+	|| eh->e_shoff + (size_t)eh->e_shnum * sizeof(ut_elf(Shdr)) > nm->size) {
+		nm->err = "broken or unsupported ELF image";
+		return(-1);
+	}
+	ut_elf(Shdr) const *sh = (ut_elf(Shdr) const *)(base + eh->e_shoff);
+
+	/* prefer .symtab; .dynsym is a subset of it, used only on stripped binaries */
+	ut_elf(Shdr) const *symtab = NULL;
+	for(size_t i = 0; i < eh->e_shnum; i++) {
+		if(sh[i].sh_type == SHT_SYMTAB) { symtab = &sh[i]; break; }
+		if(sh[i].sh_type == SHT_DYNSYM) { symtab = &sh[i]; }
+	}
+	if(symtab == NULL || symtab->sh_link >= eh->e_shnum
+	|| symtab->sh_offset + symtab->sh_size > nm->size
+	|| sh[symtab->sh_link].sh_offset + sh[symtab->sh_link].sh_size > nm->size) {
+		nm->err = "symbol table not found in the executable";
+		return(-1);
+	}
+
+	*tab = (struct ut_elf_symtab_s){
+		.sym = (ut_elf(Sym) const *)(base + symtab->sh_offset),
+		.sym_cnt = symtab->sh_size / sizeof(ut_elf(Sym)),
+		.strtab = (char const *)(base + sh[symtab->sh_link].sh_offset),
+		.strtab_size = sh[symtab->sh_link].sh_size
+	};
+	return(0);
+}
+
+static inline
+int ut_nm_scan_elf(
+	struct ut_nm_s *nm)
+{
+	struct ut_elf_symtab_s tab;
+	if(ut_elf_find_symtab(nm, &tab) != 0) {
+		return(-1);
+	}
+	ut_elf(Sym) const *sym = tab.sym;
+	size_t const sym_cnt = tab.sym_cnt;
+	char const *strtab = tab.strtab;
+	size_t const strtab_size = tab.strtab_size;
+
+	/* single pass: collect ut_get_info_* and ut_get_config_*, and locate main */
+	utkvec_t(struct ut_nm_result_s) buf;
+	uintptr_t main_addr = 0;
+	int main_found = 0;
+
+	utkv_init(buf);
+	for(size_t i = 0; i < sym_cnt; i++) {
+		if(ut_elf_st_type(sym[i].st_info) != STT_FUNC || sym[i].st_shndx == SHN_UNDEF) { continue; }
+		if(sym[i].st_name >= strtab_size) { continue; }
+
+		char const *name = &strtab[sym[i].st_name];
+		char type = ut_nm_classify(name);
+		if(type == 0) { continue; }
+		if(type == 'm') {
+			main_addr = (uintptr_t)sym[i].st_value;
+			main_found = 1;
+			continue;
+		}
+		utkv_push(buf, ((struct ut_nm_result_s){
+			.ptr = (void *)(uintptr_t)sym[i].st_value,
+			.type = type,
+			.name = name
+		}));
+	}
+
+	if(main_found == 0) {
+		nm->err = "`main' not found in the symbol table";
+		utkv_destroy(buf);
+		return(-1);
+	}
+
+	/* push terminator */
+	utkv_push(buf, (struct ut_nm_result_s){ 0 });
+	nm->res = utkv_ptr(buf);
+	nm->offset = (uintptr_t)main - main_addr;
+	return(0);
+}
+#endif	/* defined(__ELF__) */
+
+/**
+ * external nm fallback for non-ELF platforms
+ */
+static inline
+char *ut_build_nm_cmd(
+	char const *filename)
+{
+	size_t const filename_len_limit = 1024;
+	char const *cmd_base = "nm ";
+
+	/* check the length of the filename */
+	if(strlen(filename) > filename_len_limit) {
+		return(NULL);
+	}
+
+	/* cat name */
+	char *cmd = (char *)malloc(strlen(cmd_base) + strlen(filename) + 1);
+	strcpy(cmd, cmd_base);
+	strcat(cmd, filename);
+
+	return(cmd);
+}
+
+static inline
+char *ut_dump_file(
+	FILE *fp,
+	size_t *size)
+{
+	size_t len;
+	utkvec_t(char) buf;
+
+	utkv_init(buf);
+	while((len = fread(utkv_ptr(buf) + utkv_size(buf), 1, utkv_max(buf) - utkv_size(buf) - 1, fp)) > 0) {
+		utkv_size(buf) += len;
+		if(utkv_size(buf) + 1 == utkv_max(buf)) {
+			utkv_resize(buf, 2 * utkv_max(buf));
+		}
+	}
+
+	/* push terminator */
+	*size = utkv_size(buf);
+	utkv_push(buf, '\0');
+	return(utkv_ptr(buf));
+}
+
+static inline
+char *ut_dump_nm_output(
+	char const *filename,
+	size_t *size)
+{
+	char *cmd = NULL;
+	FILE *fp = NULL;
+	char *res = NULL;
+
+	/* build command */
+	if((cmd = ut_build_nm_cmd(filename)) == NULL) {
+		goto _ut_nm_error_handler;
+	}
+
+	/* open */
+	if((fp = popen(cmd, "r")) == NULL) {
+		fprintf(stderr, ut_color(UT_RED, "ERROR") ": failed to open pipe.\n");
+		goto _ut_nm_error_handler;
+	}
+
+	/* dump */
+	if((res = ut_dump_file(fp, size)) == NULL) {
+		fprintf(stderr, ut_color(UT_RED, "ERROR") ": failed to read nm output.\n");
+		goto _ut_nm_error_handler;
+	}
+
+	/* close file */
+	int status = pclose(fp); fp = NULL;
+	if(status != 0) {
+		fprintf(stderr, ut_color(UT_RED, "ERROR") ": failed to close pipe.\n");
+		goto _ut_nm_error_handler;
+	}
+	free(cmd); cmd = NULL;
+	return(res);
+
+_ut_nm_error_handler:
+	if(cmd != NULL) { free(cmd); }
+	if(fp != NULL) { pclose(fp); }
+	if(res != NULL) { free(res); }
+	return(NULL);
+}
+
+/**
+ * @fn ut_parse_nm_output
+ * @brief parse nm output in place; names are terminated in the buffer and not copied
+ */
+static inline
+int ut_parse_nm_output(
+	struct ut_nm_s *nm)
+{
+	char *p = (char *)nm->base;
+	utkvec_t(struct ut_nm_result_s) buf;
+	uintptr_t main_addr = 0;
+	int main_found = 0;
+
+	utkv_init(buf);
+	while(*p != '\0') {
+		struct ut_nm_result_s r;
+
+		/* check the sanity of the line */
+		char *sp = p;
+		while(*sp != '\r' && *sp != '\n' && *sp != '\0') { sp++; }
+		if((size_t)(sp - p) < 1) { break; }
+
+		/* if the first character of the line is space, pass the PTR state */
+		if(!isspace(*p)) {
+			char *np;
+			r.ptr = (void *)((size_t)strtoll(p, &np, 16));
+
+			/* advance pointer */
+			p = np;
+		} else {
+			r.ptr = NULL;
+		}
+
+		/* parse type (and skip it) */
+		while(isspace(*p)) { p++; }
+		p++;
+
+		/* parse name (strip leading underscore on mach-o) */
+		while(isspace(*p)) { p++; }
+		if(*p == '_') { p++; }
+		r.name = p;
+
+		/* terminate the name and adjust the pointer to the head of the next line */
+		p = sp;
+		while(*p == '\r' || *p == '\n') { *p++ = '\0'; }
+
+		r.type = ut_nm_classify(r.name);
+		if(r.type == 'm') {
+			main_addr = (uintptr_t)r.ptr;
+			main_found = 1;
+		} else if(r.type != 0) {
+			utkv_push(buf, r);
+		}
+	}
+
+	if(main_found == 0) {
+		fprintf(stderr, ut_color(UT_RED, "ERROR") ": `main' not found in the symbol table.\n");
+		utkv_destroy(buf);
+		return(-1);
+	}
+
+	/* push terminator */
+	utkv_push(buf, (struct ut_nm_result_s){ 0 });
+	nm->res = utkv_ptr(buf);
+	nm->offset = (uintptr_t)main - main_addr;
+	return(0);
+}
+
+/**
+ * @fn ut_nm_clean
+ */
+static inline
+void ut_nm_clean(
+	struct ut_nm_s *nm)
+{
+	if(nm == NULL) { return; }
+
+	#if defined(__ELF__)
+	if(nm->mapped != 0) {
+		munmap(nm->base, nm->size);
+	} else {
+		free(nm->base);
+	}
+	#else
+	free(nm->base);
+	#endif
+	free(nm->res);
+	free(nm);
+	return;
+}
+
+/**
+ * @fn ut_nm
+ * @brief collect ut_get_info_* and ut_get_config_* symbols, and compute the load offset
+ */
+static inline
+struct ut_nm_s *ut_nm(
+	char const *filename)
+{
+	struct ut_nm_s *nm = (struct ut_nm_s *)calloc(1, sizeof(struct ut_nm_s));
+
+	#if defined(__ELF__)
+	if(ut_nm_map_file(nm, filename) == 0) {
+		if(ut_nm_scan_elf(nm) == 0) { return(nm); }
+		munmap(nm->base, nm->size);
+		*nm = (struct ut_nm_s){ .err = nm->err };
+	}
+	#endif
+
+	/* fall back to the external command */
+	if((nm->base = ut_dump_nm_output(filename, &nm->size)) == NULL
+	|| ut_parse_nm_output(nm) != 0) {
+		if(nm->err != NULL) {
+			fprintf(stderr, ut_color(UT_RED, "ERROR") ": %s (%s).\n", nm->err, filename);
+		}
+		ut_nm_clean(nm);
+		return(NULL);
+	}
+	return(nm);
+}
+
+/**
+ * @struct ut_code_s
+ * @brief function symbols (runtime address and size) of the executable, for
+ * hashing the machine code of the tests (--changed-only)
+ */
+struct ut_func_s {
+	uintptr_t addr;
+	size_t size;
+
+	/* filled on the first scan */
+	uint64_t hash;			/* of the masked code of this function alone, 0 if not scanned yet */
+	size_t callee_pos, callee_cnt;
+};
+
+struct ut_code_s {
+	size_t cnt;
+	struct ut_func_s *func;	/* sorted by addr */
+	utkvec_t(size_t) callee;
+
+	/* procedure linkage table; calls to imported functions land here */
+	uintptr_t plt_lo, plt_hi;
+
+	/* traversal */
+	uint32_t *visited;		/* stamp of the last traversal */
+	uint32_t stamp;
+};
+
+static
+int ut_compare_func(
+	void const *_a,
+	void const *_b)
+{
+	struct ut_func_s const *a = (struct ut_func_s const *)_a;
+	struct ut_func_s const *b = (struct ut_func_s const *)_b;
+	return(a->addr < b->addr ? -1 : (a->addr > b->addr ? 1 : 0));
+}
+
+/**
+ * @fn ut_code_build
+ * @brief returns 0 on success, nonzero if the code cannot be located (non-ELF or no sizes)
+ */
+static inline
+int ut_code_build(
+	struct ut_code_s *code,
+	char const *filename)
+{
+	memset(code, 0, sizeof(struct ut_code_s));
+
+	#if defined(__ELF__)
+	struct ut_nm_s nm = { 0 };
+	struct ut_elf_symtab_s tab;
+	if(ut_nm_map_file(&nm, filename) != 0) { return(-1); }
+	if(ut_elf_find_symtab(&nm, &tab) != 0) {
+		munmap(nm.base, nm.size);
+		return(-1);
+	}
+
+	/* .plt, .plt.got, .plt.sec, ... */
+	ut_elf(Ehdr) const *eh = (ut_elf(Ehdr) const *)nm.base;
+	ut_elf(Shdr) const *sh = (ut_elf(Shdr) const *)((uint8_t const *)nm.base + eh->e_shoff);
+	uintptr_t plt_lo = UINTPTR_MAX, plt_hi = 0;
+	if(eh->e_shstrndx < eh->e_shnum && sh[eh->e_shstrndx].sh_offset + sh[eh->e_shstrndx].sh_size <= nm.size) {
+		char const *shstr = (char const *)nm.base + sh[eh->e_shstrndx].sh_offset;
+		for(size_t i = 0; i < eh->e_shnum; i++) {
+			if(sh[i].sh_name >= sh[eh->e_shstrndx].sh_size || ut_startswith(&shstr[sh[i].sh_name], ".plt") != 0) { continue; }
+			if(sh[i].sh_addr < plt_lo) { plt_lo = sh[i].sh_addr; }
+			if(sh[i].sh_addr + sh[i].sh_size > plt_hi) { plt_hi = sh[i].sh_addr + sh[i].sh_size; }
+		}
+	}
+
+	utkvec_t(struct ut_func_s) buf;
+	utkv_init(buf);
+	uintptr_t main_addr = 0;
+	for(size_t i = 0; i < tab.sym_cnt; i++) {
+		ut_elf(Sym) const *sym = &tab.sym[i];
+		if(ut_elf_st_type(sym->st_info) != STT_FUNC || sym->st_shndx == SHN_UNDEF || sym->st_size == 0) { continue; }
+		if(sym->st_name < tab.strtab_size && strcmp(&tab.strtab[sym->st_name], "main") == 0) {
+			main_addr = (uintptr_t)sym->st_value;
+		}
+		utkv_push(buf, ((struct ut_func_s){ .addr = (uintptr_t)sym->st_value, .size = (size_t)sym->st_size }));
+	}
+	munmap(nm.base, nm.size);
+	if(main_addr == 0) {
+		utkv_destroy(buf);
+		return(-1);
+	}
+
+	/* relocate and sort; aliases of the same function are merged */
+	uintptr_t const offset = (uintptr_t)main - main_addr;
+	struct ut_func_s *f = utkv_ptr(buf);
+	size_t cnt = 0;
+	for(size_t i = 0; i < utkv_size(buf); i++) { f[i].addr += offset; }
+	qsort(f, utkv_size(buf), sizeof(struct ut_func_s), ut_compare_func);
+	for(size_t i = 0; i < utkv_size(buf); i++) {
+		if(cnt > 0 && f[cnt - 1].addr == f[i].addr) {
+			if(f[i].size > f[cnt - 1].size) { f[cnt - 1].size = f[i].size; }
+			continue;
+		}
+		f[cnt++] = f[i];
+	}
+
+	code->cnt = cnt;
+	code->func = f;
+	utkv_init(code->callee);
+	if(plt_lo < plt_hi) {
+		code->plt_lo = plt_lo + offset;
+		code->plt_hi = plt_hi + offset;
+	}
+	code->visited = (uint32_t *)calloc(cnt + 1, sizeof(uint32_t));
+	return(0);
+	#else
+	ut_unused(filename);
+	return(-1);
+	#endif
+}
+
+static inline
+void ut_code_destroy(
+	struct ut_code_s *code)
+{
+	free(code->func);
+	free(code->visited);
+	if(code->func != NULL) { utkv_destroy(code->callee); }
+	return;
+}
+
+/**
+ * @fn ut_code_find
+ * @brief index of the function starting at addr, (size_t)-1 if none
+ */
+static inline
+size_t ut_code_find(
+	struct ut_code_s const *code,
+	uintptr_t addr)
+{
+	size_t lo = 0, hi = code->cnt;
+	while(lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if(code->func[mid].addr < addr) { lo = mid + 1; } else { hi = mid; }
+	}
+	return((lo < code->cnt && code->func[lo].addr == addr) ? lo : (size_t)-1);
+}
+
+/**
+ * @fn ut_code_scan
+ * @brief hash the code of a function with position-dependent fields masked,
+ * and record the functions it calls. the displacements of direct calls and
+ * pc-relative address loads change whenever unrelated code moves, so they are
+ * zeroed; the callees are hashed on their own instead. instructions are not
+ * decoded, so a byte pattern is taken as a call only when it lands exactly on
+ * a function start.
+ */
+static inline
+void ut_code_scan(
+	struct ut_code_s *code,
+	size_t id)
+{
+	struct ut_func_s *f = &code->func[id];
+	uint8_t *b = (uint8_t *)malloc(f->size + 8);
+	memcpy(b, (void const *)f->addr, f->size);
+	f->callee_pos = utkv_size(code->callee);
+
+	#define ut_code_memchr(_set, _c)	( memchr((_set), (_c), sizeof(_set) - 1) != NULL )
+
+	/* true if the target is a function start (recorded as a callee) or in the PLT */
+	#define ut_code_call(_target) ({ \
+		uintptr_t _t = (_target); \
+		size_t _k = ut_code_find(code, _t); \
+		if(_k != (size_t)-1) { utkv_push(code->callee, _k); } \
+		_k != (size_t)-1 || (_t >= code->plt_lo && _t < code->plt_hi); \
+	})
+
+	#if defined(__x86_64__)
+	for(size_t i = 0; i < f->size; i++) {
+		/* call / jmp rel32 */
+		if((b[i] == 0xe8 || b[i] == 0xe9) && i + 5 <= f->size) {
+			int32_t rel;
+			memcpy(&rel, &b[i + 1], sizeof(int32_t));
+			if(ut_code_call(f->addr + i + 5 + (intptr_t)rel)) {
+				memset(&b[i + 1], 0, sizeof(int32_t));
+				i += 4;
+			}
+			continue;
+		}
+		/* rip-relative memory operand (modrm mod == 00, rm == 101) of the common loads, stores and compares */
+		size_t j = i + ((b[i] & 0xf0) == 0x40);		/* REX */
+		size_t m = j + 1 + (b[j] == 0x0f);			/* two-byte opcode */
+		if(m + 5 > f->size || (b[m] & 0xc7) != 0x05) { continue; }
+		if(b[j] == 0x0f ? ut_code_memchr("\x10\x11\x28\x29\x6f\x7f\xb6\xb7\xbe\xbf", b[j + 1])
+		: ut_code_memchr("\x01\x03\x09\x0b\x21\x23\x29\x2b\x31\x33\x39\x3b\x63\x80\x81\x83\x85\x88\x89\x8b\x8d\xc6\xc7\xf7\xff", b[j])) {
+			memset(&b[m + 1], 0, sizeof(int32_t));
+			i = m + 4;
+		}
+	}
+	#elif defined(__aarch64__)
+	for(size_t i = 0; i + 4 <= f->size; i += 4) {
+		uint32_t w;
+		memcpy(&w, &b[i], sizeof(uint32_t));
+		if((w & 0x7c000000) == 0x14000000) {
+			/* b / bl imm26 */
+			int32_t imm = (int32_t)(w<<6)>>6;
+			if(ut_code_call(f->addr + i + (intptr_t)imm * 4)) { w &= 0xfc000000; }
+		} else if((w & 0x9f000000) == 0x90000000) {
+			/* adrp */
+			w &= 0x9f00001f;
+		}
+		memcpy(&b[i], &w, sizeof(uint32_t));
+	}
+	#endif
+
+	#undef ut_code_memchr
+	#undef ut_code_call
+
+	f->callee_cnt = utkv_size(code->callee) - f->callee_pos;
+	f->hash = ut_hash_bytes(f->size, b, f->size) | 1;
+	free(b);
+	return;
+}
+
+/**
+ * @fn ut_code_hash
+ * @brief hash of the functions reachable from the roots by direct calls; roots
+ * not found in the symbol table (NULL or external) contribute only their absence
+ */
+static inline
+uint64_t ut_code_hash(
+	struct ut_code_s *code,
+	void const *const *root,
+	size_t root_cnt)
+{
+	if(++code->stamp == 0) {
+		memset(code->visited, 0, sizeof(uint32_t) * code->cnt);
+		code->stamp = 1;
+	}
+
+	size_t *stack = (size_t *)malloc(sizeof(size_t) * (code->cnt + 1));
+	uint64_t h = 0;
+	for(size_t i = 0; i < root_cnt; i++) {
+		size_t k = root[i] == NULL ? (size_t)-1 : ut_code_find(code, (uintptr_t)root[i]);
+		uint64_t const found = k != (size_t)-1;
+		h = ut_hash_bytes(h, &found, sizeof(uint64_t));
+		if(found == 0 || code->visited[k] == code->stamp) { continue; }
+
+		/* depth-first over the call graph */
+		size_t sp = 0;
+		code->visited[k] = code->stamp;
+		stack[sp++] = k;
+		while(sp > 0) {
+			struct ut_func_s *f = &code->func[stack[--sp]];
+			if(f->hash == 0) { ut_code_scan(code, f - code->func); }
+			h = ut_hash_bytes(h, &f->hash, sizeof(uint64_t));
+
+			for(size_t j = 0; j < f->callee_cnt; j++) {
+				size_t c = utkv_at(code->callee, f->callee_pos + j);
+				if(code->visited[c] == code->stamp) { continue; }
+				code->visited[c] = code->stamp;
+				stack[sp++] = c;
+			}
+		}
+	}
+	free(stack);
+	return(h);
+}
+
+/**
+ * @struct ut_registry_s
+ * @brief pointers to the static info objects of the tests and the groups; they
+ * are ordered by index permutations and copied out only once (ut_gather).
+ */
+struct ut_registry_s {
+	struct ut_s const **test;
+	size_t test_cnt;
+	struct ut_group_config_s const **config;
+	size_t config_cnt;
+};
+
+static inline
+void ut_registry_destroy(
+	struct ut_registry_s *reg)
+{
+	free(reg->test);
+	free(reg->config);
+	return;
+}
+
+/**
+ * @fn ut_get_registry
+ * @brief call ut_get_info_* and ut_get_config_* found in the symbol table
+ */
+static inline
+void ut_get_registry(
+	struct ut_nm_s const *nm,
+	struct ut_registry_s *reg)
+{
+	#define ut_get_info_call_func(_ptr, _offset) ( \
+		(struct ut_s const *(*)(void))((uintptr_t)(_ptr) + (uintptr_t)(_offset)) \
+	)
+	#define ut_get_config_call_func(_ptr, _offset) ( \
+		(struct ut_group_config_s const *(*)(void))((uintptr_t)(_ptr) + (uintptr_t)(_offset)) \
+	)
+
+	/* count first; no reallocation */
+	size_t test_cnt = 0, config_cnt = 0;
+	for(struct ut_nm_result_s const *r = nm->res; r->type != (char)0; r++) {
+		test_cnt += r->type == UT_NM_INFO;
+		config_cnt += r->type == UT_NM_CONFIG;
+	}
+
+	*reg = (struct ut_registry_s){
+		.test = (struct ut_s const **)malloc(sizeof(struct ut_s const *) * (test_cnt + 1)),
+		.config = (struct ut_group_config_s const **)malloc(sizeof(struct ut_group_config_s const *) * (config_cnt + 1))
+	};
+	for(struct ut_nm_result_s const *r = nm->res; r->type != (char)0; r++) {
+		if(r->type == UT_NM_INFO) {
+			reg->test[reg->test_cnt++] = ut_get_info_call_func(r->ptr, nm->offset)();
+		} else if(r->type == UT_NM_CONFIG) {
+			reg->config[reg->config_cnt++] = ut_get_config_call_func(r->ptr, nm->offset)();
+		}
+	}
+
+	#undef ut_get_info_call_func
+	#undef ut_get_config_call_func
+	return;
+}
+
+#if UNITTEST_USE_SECTION != 0
+/**
+ * section registry; bounds are provided by the linker (declared weak to allow empty sections)
+ */
+#if defined(__APPLE__)
+extern struct ut_s const *const ut_tests_start[] __asm("section$start$__DATA$ut_tests");
+extern struct ut_s const *const ut_tests_stop[] __asm("section$end$__DATA$ut_tests");
+extern struct ut_group_config_s const *const ut_groups_start[] __asm("section$start$__DATA$ut_groups");
+extern struct ut_group_config_s const *const ut_groups_stop[] __asm("section$end$__DATA$ut_groups");
+#else
+extern struct ut_s const *const __start_ut_tests[] __attribute__(( weak ));
+extern struct ut_s const *const __stop_ut_tests[] __attribute__(( weak ));
+extern struct ut_group_config_s const *const __start_ut_groups[] __attribute__(( weak ));
+extern struct ut_group_config_s const *const __stop_ut_groups[] __attribute__(( weak ));
+#  define ut_tests_start		__start_ut_tests
+#  define ut_tests_stop			__stop_ut_tests
+#  define ut_groups_start		__start_ut_groups
+#  define ut_groups_stop		__stop_ut_groups
+#endif
+
+static inline
+void ut_get_registry_section(
+	struct ut_registry_s *reg)
+{
+	size_t const test_max = ut_tests_stop - ut_tests_start;
+	size_t const config_max = ut_groups_stop - ut_groups_start;
+
+	*reg = (struct ut_registry_s){
+		.test = (struct ut_s const **)malloc(sizeof(struct ut_s const *) * (test_max + 1)),
+		.config = (struct ut_group_config_s const **)malloc(sizeof(struct ut_group_config_s const *) * (config_max + 1))
+	};
+	for(size_t i = 0; i < test_max; i++) {
+		if(ut_tests_start[i] == NULL) { continue; }	/* skip padding */
+		reg->test[reg->test_cnt++] = ut_tests_start[i];
+	}
+	for(size_t i = 0; i < config_max; i++) {
+		if(ut_groups_start[i] == NULL) { continue; }
+		reg->config[reg->config_cnt++] = ut_groups_start[i];
+	}
+	return;
+}
+#endif	/* UNITTEST_USE_SECTION != 0 */
+
+static inline
+void ut_dump_test(
+	struct ut_s const *test)
+{
+	struct ut_s const *t = test;
+	while(t->file != NULL) {
+		printf("%s, %zu, %zu, %s, %s, %p, %p\n",
+			t->file,
+			t->line,
+			t->unique_id,
+			t->name,
+			t->depends_on[0],
+			(void *)t->init,
 			(void *)t->clean);
 		t++;
 	}
@@ -833,625 +3414,2765 @@ void ut_dump_test(
 }
 
 static inline
-void ut_dump_config(
+void ut_dump_config(
+	struct ut_group_config_s const *config)
+{
+	struct ut_group_config_s const *c = config;
+	while(c->file != NULL) {
+		printf("%s, %zu, %s, %s, %p, %p\n",
+			c->file,
+			c->unique_id,
+			c->name,
+			c->depends_on[0],
+			(void *)c->init,
+			(void *)c->clean);
+		c++;
+	}
+	return;
+}
+
+static
+int ut_compare(
+	void const *_a,
+	void const *_b)
+{
+	struct ut_s const *a = (struct ut_s const *)_a;
+	struct ut_s const *b = (struct ut_s const *)_b;
+
+	int64_t comp_res = 0;
+	/* first sort by file name */
+	if((comp_res = ut_strcmp(a->file, b->file)) != 0) {
+		return(comp_res);
+	}
+
+	#define sat(a)	( ((a) > INT32_MAX) ? INT32_MAX : (((a) < INT32_MIN) ? INT32_MIN : (a)) )
+
+	if((comp_res = (int64_t)(a->unique_id - b->unique_id)) != 0) {
+		return(sat(comp_res));
+	}
+
+	#undef sat
+
+	/* third sort by name */
+	if((comp_res = ut_strcmp(a->name, b->name)) != 0) {
+		return(comp_res);
+	}
+
+	/* last, sort by line number */
+	return((int)(a->line - b->line));
+}
+
+static inline
+int ut_match(
+	void const *_a,
+	void const *_b)
+{
+	struct ut_s const *a = (struct ut_s *)_a;
+	struct ut_s const *b = (struct ut_s *)_b;
+	return((ut_strcmp(a->file, b->file) == 0 && a->unique_id == b->unique_id) ? 0 : 1);
+}
+
+static inline
+size_t ut_get_total_test_count(
+	struct ut_s const *test)
+{
+	size_t cnt = 0;
+	struct ut_s const *t = test;
+	while(t->file != NULL) { t++; cnt++; }
+	return(cnt);
+}
+
+static inline
+size_t ut_get_total_config_count(
+	struct ut_group_config_s const *config)
+{
+	size_t cnt = 0;
+	struct ut_group_config_s const *c = config;
+	while(c->file != NULL) { c++; cnt++; }
+	return(cnt);
+}
+
+static inline
+size_t ut_get_total_file_count(
+	struct ut_s const *sorted_test)
+{
+	size_t cnt = 1;
+	struct ut_s const *t = sorted_test;
+
+	if(t++->file == NULL) {
+		return(0);
+	}
+
+	while(t->file != NULL) {
+		// printf("comp %s and %s\n", (t - 1)->file, t->file);
+		if(ut_match((void *)(t - 1), (void *)t) != 0) {
+			cnt++;
+		}
+		t++;
+	}
+	return(cnt);
+}
+
+/**
+ * @fn ut_sort_perm
+ * @brief stable merge sort of a 32-bit index permutation; objects are compared
+ * through the pointers and never moved
+ */
+static inline
+uint32_t *ut_sort_perm(
+	void const *const *ptr,
+	size_t cnt,
+	int (*cmp)(void const *, void const *))
+{
+	uint32_t *perm = (uint32_t *)malloc(sizeof(uint32_t) * (cnt + 1));
+	uint32_t *buf = (uint32_t *)malloc(sizeof(uint32_t) * (cnt + 1));
+	for(size_t i = 0; i < cnt; i++) { perm[i] = (uint32_t)i; }
+
+	uint32_t *src = perm, *dst = buf;
+	for(size_t w = 1; w < cnt; w *= 2) {
+		for(size_t lo = 0; lo < cnt; lo += 2 * w) {
+			size_t mid = lo + w < cnt ? lo + w : cnt;
+			size_t hi = lo + 2 * w < cnt ? lo + 2 * w : cnt;
+			size_t i = lo, j = mid, k = lo;
+			while(i < mid && j < hi) {
+				dst[k++] = cmp(ptr[src[j]], ptr[src[i]]) < 0 ? src[j++] : src[i++];
+			}
+			while(i < mid) { dst[k++] = src[i++]; }
+			while(j < hi) { dst[k++] = src[j++]; }
+		}
+		uint32_t *t = src; src = dst; dst = t;
+	}
+
+	if(src != perm) { memcpy(perm, src, sizeof(uint32_t) * cnt); }
+	free(buf);
+	return(perm);
+}
+
+/**
+ * @fn ut_gather
+ * @brief copy the objects in the permutation order into a zero-terminated array;
+ * ptr is an array of pointers (stride 0) or the base of an array of objects (stride = size).
+ */
+static inline
+void *ut_gather(
+	void const *ptr,
+	size_t stride,
+	uint32_t const *perm,
+	size_t cnt,
+	size_t size)
+{
+	uint8_t *arr = (uint8_t *)malloc(size * (cnt + 1));
+	for(size_t i = 0; i < cnt; i++) {
+		void const *src = stride == 0
+			? ((void const *const *)ptr)[perm[i]]
+			: (void const *)((uint8_t const *)ptr + stride * perm[i]);
+		memcpy(&arr[size * i], src, size);
+	}
+	memset(&arr[size * cnt], 0, size);
+	return((void *)arr);
+}
+
+static inline
+size_t *ut_build_file_index(
+	struct ut_s const *sorted_test)
+{
+	size_t cnt = 1;
+	utkvec_t(size_t) idx;
+	struct ut_s const *t = sorted_test;
+
+	utkv_init(idx);
+	if(t++->file == NULL) {
+		utkv_push(idx, 0);
+		utkv_push(idx, -1);
+		return(utkv_ptr(idx));
+	}
+
+	utkv_push(idx, 0);
+	while(t->file != NULL) {
+		// printf("comp %s and %s\n", (t - 1)->name, t->name);
+		if(ut_match((void *)(t - 1), (void *)t) != 0) {
+			utkv_push(idx, cnt);
+		}
+		cnt++;
+		t++;
+	}
+
+	utkv_push(idx, cnt);
+	utkv_push(idx, -1);
+	return(utkv_ptr(idx));
+}
+
+static inline
+struct ut_group_config_s *ut_compensate_config(
+	struct ut_s *sorted_test,
+	struct ut_group_config_s *sorted_config)
+{
+	// printf("compensate config\n");
+	// ut_dump_test(sorted_test);
+	// ut_dump_config(sorted_config);
+
+	size_t *file_idx = ut_build_file_index(sorted_test);
+	utkvec_t(struct ut_group_config_s) compd_config;
+	utkv_init(compd_config);
+
+	size_t i = 0;
+	// printf("%zu\n", file_idx[i]);
+	struct ut_s const *t = &sorted_test[file_idx[i]];
+	struct ut_group_config_s const *c = sorted_config;
+
+	while(c->file != NULL && t->file != NULL) {
+		while(ut_match((void *)t, (void *)c) != 0) {
+			// printf("filename does not match %s, %s\n", c->file, t->file);
+			utkv_push(compd_config, (struct ut_group_config_s){ .file = t->file });
+			t = &sorted_test[file_idx[++i]];
+		}
+		// printf("matched %s, %s\n", c->file, t->file);
+		utkv_push(compd_config, *c);
+		c++;
+		t = &sorted_test[file_idx[++i]];
+	}
+
+	free(file_idx);
+	return(utkv_ptr(compd_config));
+}
+
+/**
+ * @fn ut_hash_name
+ * @brief FNV-1a
+ */
+static inline
+size_t ut_hash_name(
+	char const *name)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	while(*name != '\0') {
+		h ^= (uint8_t)*name++;
+		h *= 0x100000001b3ULL;
+	}
+	return((size_t)(h ^ (h>>32)));
+}
+
+/**
+ * @struct ut_name_table_s
+ * @brief name -> node index table (open addressing); nodes sharing a name are chained with next
+ */
+struct ut_name_table_s {
+	size_t mask;
+	size_t *slot;			/* (head node index) + 1, 0 when empty */
+	size_t *next;			/* (next node with the same name) + 1, 0 at the tail */
+};
+
+#define ut_node_name(_base, _stride, _i) ( \
+	*(char const *const *)((uint8_t const *)(_base) + (_stride) * (_i) + offsetof(struct ut_s, name)) \
+)
+#define ut_node_depends_on(_base, _stride, _i) ( \
+	(char const *const *)((uint8_t const *)(_base) + (_stride) * (_i) + offsetof(struct ut_s, depends_on)) \
+)
+
+static inline
+void ut_name_table_build(
+	struct ut_name_table_s *tbl,
+	void const *base,
+	size_t stride,
+	size_t cnt)
+{
+	size_t size = 2 * cnt + 1;
+	utkv_roundup32(size);
+
+	tbl->mask = size - 1;
+	tbl->slot = (size_t *)calloc(size, sizeof(size_t));
+	tbl->next = (size_t *)calloc(cnt + 1, sizeof(size_t));
+
+	/* insert in reverse order to keep chains in ascending node order */
+	for(size_t i = cnt; i > 0; i--) {
+		char const *name = ut_node_name(base, stride, i - 1);
+		if(name == NULL) { continue; }
+
+		size_t h = ut_hash_name(name) & tbl->mask;
+		while(tbl->slot[h] != 0 && strcmp(ut_node_name(base, stride, tbl->slot[h] - 1), name) != 0) {
+			h = (h + 1) & tbl->mask;
+		}
+		tbl->next[i - 1] = tbl->slot[h];
+		tbl->slot[h] = i;
+	}
+	return;
+}
+
+/**
+ * @fn ut_name_table_get
+ * @brief returns (head node index) + 1 of the name, 0 if not found
+ */
+static inline
+size_t ut_name_table_get(
+	struct ut_name_table_s const *tbl,
+	void const *base,
+	size_t stride,
+	char const *name)
+{
+	size_t h = ut_hash_name(name) & tbl->mask;
+	while(tbl->slot[h] != 0) {
+		if(strcmp(ut_node_name(base, stride, tbl->slot[h] - 1), name) == 0) {
+			return(tbl->slot[h]);
+		}
+		h = (h + 1) & tbl->mask;
+	}
+	return(0);
+}
+
+static inline
+void ut_name_table_destroy(
+	struct ut_name_table_s *tbl)
+{
+	free(tbl->slot);
+	free(tbl->next);
+	return;
+}
+
+/**
+ * @struct ut_dag_s
+ * @brief out-edge lists (CSR) and in-degrees of a dependency graph
+ */
+struct ut_dag_s {
+	size_t cnt;
+	size_t *head;			/* out-edges of node i are adj[head[i]] .. adj[head[i + 1] - 1] */
+	size_t *adj;
+	size_t *indeg;
+};
+
+/**
+ * @fn ut_dag_pack
+ * @brief pack (from, to) pairs into CSR
+ */
+static inline
+void ut_dag_pack(
+	struct ut_dag_s *dag,
+	size_t cnt,
+	size_t const *edge,
+	size_t edge_cnt)
+{
+	dag->cnt = cnt;
+	dag->head = (size_t *)calloc(cnt + 1, sizeof(size_t));
+	dag->adj = (size_t *)malloc(sizeof(size_t) * (edge_cnt + 1));
+	dag->indeg = (size_t *)calloc(cnt + 1, sizeof(size_t));
+
+	for(size_t e = 0; e < edge_cnt; e++) {
+		dag->head[edge[2 * e] + 1]++;
+		dag->indeg[edge[2 * e + 1]]++;
+	}
+	for(size_t i = 0; i < cnt; i++) {
+		dag->head[i + 1] += dag->head[i];
+	}
+
+	size_t *fill = (size_t *)malloc(sizeof(size_t) * (cnt + 1));
+	memcpy(fill, dag->head, sizeof(size_t) * (cnt + 1));
+	for(size_t e = 0; e < edge_cnt; e++) {
+		dag->adj[fill[edge[2 * e]]++] = edge[2 * e + 1];
+	}
+	free(fill);
+	return;
+}
+
+/**
+ * @fn ut_dag_build
+ * @brief build graph from the name / depends_on fields of struct ut_s or struct ut_group_config_s
+ */
+static inline
+void ut_dag_build(
+	struct ut_dag_s *dag,
+	void const *base,
+	size_t stride,
+	size_t cnt)
+{
+	struct ut_name_table_s tbl;
+	ut_name_table_build(&tbl, base, stride, cnt);
+
+	/* enumerate edges (from -> to) */
+	utkvec_t(size_t) edge;
+	utkv_init(edge);
+	for(size_t i = 0; i < cnt; i++) {
+		char const *const *d = ut_node_depends_on(base, stride, i);
+		for(size_t k = 0; k < 16 && d[k] != NULL; k++) {
+			for(size_t j = ut_name_table_get(&tbl, base, stride, d[k]); j != 0; j = tbl.next[j - 1]) {
+				if(j - 1 == i) { continue; }
+				utkv_push(edge, j - 1);
+				utkv_push(edge, i);
+			}
+		}
+	}
+	ut_dag_pack(dag, cnt, utkv_ptr(edge), utkv_size(edge) / 2);
+
+	utkv_destroy(edge);
+	ut_name_table_destroy(&tbl);
+	return;
+}
+
+static inline
+void ut_dag_destroy(
+	struct ut_dag_s *dag)
+{
+	free(dag->head);
+	free(dag->adj);
+	free(dag->indeg);
+	return;
+}
+
+/**
+ * @fn ut_heap_push, ut_heap_pop
+ * @brief binary min-heap of node indices
+ */
+static inline
+void ut_heap_push(
+	size_t *heap,
+	size_t *cnt,
+	size_t x)
+{
+	size_t k = (*cnt)++;
+	while(k > 0 && heap[(k - 1) / 2] > x) {
+		heap[k] = heap[(k - 1) / 2];
+		k = (k - 1) / 2;
+	}
+	heap[k] = x;
+	return;
+}
+
+static inline
+size_t ut_heap_pop(
+	size_t *heap,
+	size_t *cnt)
+{
+	size_t top = heap[0], last = heap[--(*cnt)], k = 0;
+	while(2 * k + 1 < *cnt) {
+		size_t c = 2 * k + 1;
+		if(c + 1 < *cnt && heap[c + 1] < heap[c]) { c++; }
+		if(heap[c] >= last) { break; }
+		heap[k] = heap[c];
+		k = c;
+	}
+	heap[k] = last;
+	return(top);
+}
+
+/**
+ * @fn ut_toposort_impl
+ * @brief Kahn's algorithm on the name / depends_on fields of struct ut_s or struct ut_group_config_s.
+ * the ready queue is a min-heap on the node index, so independent nodes keep their original order.
+ * returns the permutation, or NULL on circular dependency.
+ */
+static inline
+size_t *ut_toposort_impl(
+	void const *base,
+	size_t stride,
+	size_t cnt)
+{
+	struct ut_dag_s dag;
+	ut_dag_build(&dag, base, stride, cnt);
+
+	/* ready queue */
+	size_t *heap = (size_t *)malloc(sizeof(size_t) * (cnt + 1));
+	size_t hcnt = 0;
+	for(size_t i = 0; i < cnt; i++) {
+		if(dag.indeg[i] == 0) { ut_heap_push(heap, &hcnt, i); }
+	}
+
+	size_t *perm = (size_t *)malloc(sizeof(size_t) * (cnt + 1));
+	size_t pcnt = 0;
+	while(hcnt > 0) {
+		size_t node_id = ut_heap_pop(heap, &hcnt);
+		perm[pcnt++] = node_id;
+
+		/* delete out-edges */
+		for(size_t e = dag.head[node_id]; e < dag.head[node_id + 1]; e++) {
+			if(--dag.indeg[dag.adj[e]] == 0) { ut_heap_push(heap, &hcnt, dag.adj[e]); }
+		}
+	}
+
+	/* cleanup */
+	free(heap);
+	ut_dag_destroy(&dag);
+
+	/* nodes left unvisited are on a cycle */
+	if(pcnt != cnt) {
+		free(perm);
+		return(NULL);
+	}
+	return(perm);
+}
+
+/**
+ * @fn ut_toposort
+ * @brief order the tests by the dependencies within each group, and the groups
+ * (compd_config, and the tests with them) by the dependencies between groups.
+ * the orders are composed as permutations and the tests are moved only once.
+ */
+static inline
+int ut_toposort(
+	struct ut_s **test,
+	size_t test_cnt,
+	struct ut_group_config_s *compd_config,
+	size_t const *file_idx,
+	size_t file_cnt)
+{
+	/* tests in each group */
+	uint32_t *perm = (uint32_t *)malloc(sizeof(uint32_t) * (test_cnt + 1));
+	for(size_t g = 0; g < file_cnt; g++) {
+		size_t *p = ut_toposort_impl(&(*test)[file_idx[g]], sizeof(struct ut_s), file_idx[g + 1] - file_idx[g]);
+		if(p == NULL) {
+			fprintf(stderr,
+				ut_color(UT_RED, "ERROR") ": detected circular dependency in the tests in `" ut_color(UT_MAGENTA, "%s") "'.\n",
+				(*test)[file_idx[g]].file);
+			free(perm);
+			return(-1);
+		}
+		for(size_t i = 0; i < file_idx[g + 1] - file_idx[g]; i++) {
+			perm[file_idx[g] + i] = (uint32_t)(file_idx[g] + p[i]);
+		}
+		free(p);
+	}
+
+	/* groups */
+	size_t *gperm = ut_toposort_impl(compd_config, sizeof(struct ut_group_config_s), file_cnt);
+	if(gperm == NULL) {
+		fprintf(stderr, ut_color(UT_RED, "ERROR") ": detected circular dependency between groups.\n");
+		free(perm);
+		return(-1);
+	}
+
+	/* compose and apply */
+	uint32_t *order = (uint32_t *)malloc(sizeof(uint32_t) * (test_cnt + 1));
+	uint32_t *gorder = (uint32_t *)malloc(sizeof(uint32_t) * (file_cnt + 1));
+	size_t k = 0;
+	for(size_t i = 0; i < file_cnt; i++) {
+		gorder[i] = (uint32_t)gperm[i];
+		for(size_t j = file_idx[gperm[i]]; j < file_idx[gperm[i] + 1]; j++) {
+			order[k++] = perm[j];
+		}
+	}
+
+	struct ut_s *sorted = (struct ut_s *)ut_gather(*test, sizeof(struct ut_s), order, test_cnt, sizeof(struct ut_s));
+	free(*test);
+	*test = sorted;
+
+	struct ut_group_config_s *c = (struct ut_group_config_s *)ut_gather(compd_config,
+		sizeof(struct ut_group_config_s), gorder, file_cnt, sizeof(struct ut_group_config_s));
+	memcpy(compd_config, c, sizeof(struct ut_group_config_s) * file_cnt);
+
+	free(c);
+	free(gorder);
+	free(order);
+	free(gperm);
+	free(perm);
+	return(0);
+}
+
+/**
+ * @fn ut_build_short_option_string
+ * @brief build short getopt string (i.e. "a:b:vVQ") from an array of struct option
+ */
+static inline
+char *ut_build_short_option_string(struct option const *opts)
+{
+	char *str = NULL, *ps;
+	size_t len = 0;
+	struct option const *po = NULL;
+
+	for(po = opts; po->name != NULL; po++) { len++; }
+	str = ps = (char *)malloc(3 * len + 1);
+	for(po = opts; po->name != NULL; po++) {
+		if(po->val > 0xff) { continue; }	/* long-only option */
+		*ps++ = (char)po->val;
+		if(po->has_arg != no_argument) {
+			*ps++ = ':';
+		}
+		if(po->has_arg == optional_argument) {
+			*ps++ = ':';
+		}
+	}
+	*ps = '\0';
+	return(str);
+}
+
+/**
+ * @fn ut_modify_test_config_mark
+ * @brief mark tests (or groups) by name; stride is the size of the element
+ */
+#define ut_node_exec(_base, _stride, _i) ( \
+	*(size_t *)((uint8_t *)(_base) + (_stride) * (_i) + offsetof(struct ut_s, exec)) \
+)
+
+static inline
+int ut_modify_test_config_mark(
+	char const *arg,
+	void *base,
+	size_t stride,
+	size_t cnt)
+{
+	for(size_t i = 0; i < cnt; i++) {
+		ut_node_exec(base, stride, i) = 0;
+	}
+
+	char const *p = arg, *b = arg;
+	while(*p != '\0') {
+		/* parse with comma */
+		while(*p != '\0' && *p != ',') { p++; }
+
+		/* copy string */
+		char buf[p - b + 1];
+		memcpy(buf, b, p - b);
+		buf[p - b] = '\0';
+
+		/* linear search among tests */
+		int marked = 0;
+		for(size_t i = 0; i < cnt; i++) {
+			if(ut_strcmp(ut_node_name(base, stride, i), buf) == 0) {
+				ut_node_exec(base, stride, i) = 2; marked = 1;
+			}
+		}
+		if(marked == 0) {
+			fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": group `%s' not found.\n", buf);
+		}
+
+		if(*p == '\0') { break; }
+		b = ++p;
+	}
+	return(0);
+}
+
+/**
+ * @fn ut_modify_test_config_all
+ */
+static inline
+int ut_modify_test_config_all(
+	void *base,
+	size_t stride,
+	size_t cnt)
+{
+	for(size_t i = 0; i < cnt; i++) {
+		ut_node_exec(base, stride, i) = 1;
+	}
+	return(0);
+}
+
+/**
+ * @fn ut_print_help
+ */
+static inline
+void ut_print_help(void)
+{
+	static char const *help_message =
+		"\n"
+		"  unittest.h -- simple unittesting framework for C99\n"
+		"\n"
+		"  Options:\n"
+		"    -g, --group   [STR,...]  specify group names\n"
+		"    -t, --test    [STR,...]  specify test names\n"
+		"    -s, --seed    [INT       invoke libc::srand with the seed\n"
+		"    -o, --stdout             redirect to stdout\n"
+		"    -j, --json               print result in json\n"
+		"    -n, --threads [INT]      number of threads\n"
+		"        --ordered            print failures in the test order\n"
+		"    -i, --isolate            run tests in forked workers (crash isolation)\n"
+		"        --timeout [MS]       default per-test timeout\n"
+		"    -c, --catch-signals      recover from SIGSEGV, SIGBUS, SIGFPE and SIGILL in-process\n"
+		"    -f, --fail-fast[=INT]    stop starting tests after INT (default 1) failed tests\n"
+		"    -b, --bench              run benchmarks (unittest_bench) as well\n"
+		"        --bench-time [MS]    target duration of a benchmark sample\n"
+		"        --slowest [INT]      list the slowest tests\n"
+		"        --slow    [MS]       flag tests slower than the threshold\n"
+		"        --shard   [I/N]      run the I-th (0-origin) of N shards\n"
+		"        --timing  [FILE]     balance shards by the durations in the file\n"
+		"        --save-timing [FILE] write durations of this run to the file\n"
+		"        --history [FILE]     run failed and long tests first, by the history in the file\n"
+		"        --changed-only[=FILE] run only tests whose code changed since they passed\n"
+		"        --profile [FILE]     write the timings of the runner phases in json\n"
+		"        --snapshot-dir [DIR] directory of the golden files (default: " UNITTEST_SNAPSHOT_DIR ")\n"
+		"        --update-snapshots   rewrite golden files that are missing or different\n"
+		"    -h, --help               show this message\n"
+		"\n"
+		"  this is an auto-generated message from unittest.h\n"
+		"  the latest source is available at:\n"
+		"    https://github.com/ocxtal/unittest.h\n"
+		"\n";
+
+	fprintf(stderr, "%s", help_message);
+	return;
+}
+
+/* long-only options */
+enum ut_long_option_e {
+	UT_OPT_ORDERED = 0x100,
+	UT_OPT_BENCH_TIME,
+	UT_OPT_SLOWEST,
+	UT_OPT_SLOW,
+	UT_OPT_TIMEOUT,
+	UT_OPT_SHARD,
+	UT_OPT_TIMING,
+	UT_OPT_SAVE_TIMING,
+	UT_OPT_HISTORY,
+	UT_OPT_CHANGED_ONLY,
+	UT_OPT_PROFILE,
+	UT_OPT_SNAPSHOT_DIR,
+	UT_OPT_UPDATE_SNAPSHOTS
+};
+
+/**
+ * @fn ut_modify_test_config
+ */
+static inline
+int ut_modify_test_config(
+	int argc,
+	char *const argv[],
+	struct ut_global_config_s *params,
+	struct ut_s *sorted_test,
+	size_t test_cnt,
+	struct ut_group_config_s *sorted_config,
+	size_t file_cnt)
+{
+	static struct option const opts_long[] = {
+		{ "group", required_argument, NULL, 'g' },
+		{ "test", required_argument, NULL, 't' },
+		{ "seed", required_argument, NULL, 's' },
+		{ "stdout", no_argument, NULL, 'o' },
+		{ "json", no_argument, NULL, 'j' },
+		{ "threads", required_argument, NULL, 'n' },
+		{ "ordered", no_argument, NULL, UT_OPT_ORDERED },
+		{ "isolate", no_argument, NULL, 'i' },
+		{ "timeout", required_argument, NULL, UT_OPT_TIMEOUT },
+		{ "catch-signals", no_argument, NULL, 'c' },
+		{ "fail-fast", optional_argument, NULL, 'f' },
+		{ "bench", no_argument, NULL, 'b' },
+		{ "bench-time", required_argument, NULL, UT_OPT_BENCH_TIME },
+		{ "slowest", required_argument, NULL, UT_OPT_SLOWEST },
+		{ "slow", required_argument, NULL, UT_OPT_SLOW },
+		{ "shard", required_argument, NULL, UT_OPT_SHARD },
+		{ "timing", required_argument, NULL, UT_OPT_TIMING },
+		{ "save-timing", required_argument, NULL, UT_OPT_SAVE_TIMING },
+		{ "history", required_argument, NULL, UT_OPT_HISTORY },
+		{ "changed-only", optional_argument, NULL, UT_OPT_CHANGED_ONLY },
+		{ "profile", required_argument, NULL, UT_OPT_PROFILE },
+		{ "snapshot-dir", required_argument, NULL, UT_OPT_SNAPSHOT_DIR },
+		{ "update-snapshots", no_argument, NULL, UT_OPT_UPDATE_SNAPSHOTS },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	char *opts_short = ut_build_short_option_string(opts_long);
+
+	int c, idx;
+	char const *group_arg = NULL, *test_arg = NULL;
+	while((c = getopt_long(argc, argv, opts_short, opts_long, &idx)) != -1) {
+		switch(c) {
+			case 'g': group_arg = optarg; break;
+			case 't': test_arg = optarg; break;
+			case 's': srand((unsigned int)atol(optarg)); break;
+			case 'j': params->printer = ut_json_printer; break;
+			case 'o': params->fp = stdout; break;
+			case 'n': params->threads = atoi(optarg); break;
+			case UT_OPT_ORDERED: params->ordered = 1; break;
+			case 'i': params->isolate = 1; break;
+			case UT_OPT_TIMEOUT: params->timeout_ms = atol(optarg); break;
+			case 'c':
+#if UT_HAVE_CATCH
+				params->catch_signals = 1;
+#else
+				fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": --catch-signals is not available (include unittest.h before any system header); ignored.\n");
+#endif
+				break;
+			case 'f': params->fail_fast = optarg != NULL ? (size_t)atol(optarg) : 1; break;
+			case 'b': params->bench = 1; break;
+			case UT_OPT_BENCH_TIME: params->bench_time_ms = atoi(optarg); break;
+			case UT_OPT_SLOWEST: params->slowest = atoi(optarg); break;
+			case UT_OPT_SLOW: params->slow_ms = atof(optarg); break;
+			case UT_OPT_SHARD:
+				if(sscanf(optarg, "%zu/%zu", &params->shard_index, &params->shard_count) != 2
+				|| params->shard_index >= params->shard_count) {
+					fprintf(stderr, ut_color(UT_RED, "ERROR") ": invalid shard `%s' (expected INDEX/COUNT, 0 <= INDEX < COUNT).\n", optarg);
+					free(opts_short);
+					return(1);
+				}
+				break;
+			case UT_OPT_TIMING: params->timing_file = optarg; break;
+			case UT_OPT_SAVE_TIMING: params->save_timing_file = optarg; break;
+			case UT_OPT_HISTORY: params->history_file = optarg; break;
+			case UT_OPT_CHANGED_ONLY: params->changed_only = 1; params->cache_file = optarg; break;
+			case UT_OPT_PROFILE: params->profile_file = optarg; break;
+			case UT_OPT_SNAPSHOT_DIR: params->snapshot_dir = optarg; break;
+			case UT_OPT_UPDATE_SNAPSHOTS: params->update_snapshots = 1; break;
+			case 'h': ut_print_help(); return(1);
+			default: break;
+		}
+	}
+
+	if(group_arg != NULL) {
+		ut_modify_test_config_mark(group_arg, (void *)sorted_config, sizeof(struct ut_group_config_s), file_cnt);
+	} else {
+		ut_modify_test_config_all((void *)sorted_config, sizeof(struct ut_group_config_s), file_cnt);
+	}
+
+	if(test_arg != NULL) {
+		ut_modify_test_config_mark(test_arg, (void *)sorted_test, sizeof(struct ut_s), test_cnt);
+	} else {
+		ut_modify_test_config_all((void *)sorted_test, sizeof(struct ut_s), test_cnt);
+	}
+
+	/* benchmarks are skipped unless requested */
+	for(size_t i = 0; i < test_cnt; i++) {
+		if(sorted_test[i].bench != 0 && params->bench == 0) { sorted_test[i].exec = 0; }
+	}
+
+	free(opts_short);
+	return(0);
+}
+
+/**
+ * @fn ut_propagate_config
+ */
+static inline
+void ut_propagate_config(
+	struct ut_s *test,
+	size_t test_cnt,
+	struct ut_group_config_s *compd_config,
+	size_t *sorted_file_idx,
+	size_t file_cnt)
+{
+	ut_unused(test_cnt);
+
+	/* set index and copy exec flag */
+	for(size_t i = 0; i < file_cnt; i++) {
+		for(size_t j = sorted_file_idx[i]; j < sorted_file_idx[i + 1]; j++) {
+			test[j].index = i;
+			test[j].succ = 0;		/* clear counters */
+			test[j].fail = 0;
+			if(compd_config[i].exec == 0) { test[j].exec = 0; }
+		}
+	}
+	return;
+}
+
+/**
+ * @struct ut_record_s
+ * @brief per-test record of the previous runs, loaded from a timing / history file
+ */
+struct ut_record_s {
+	uint64_t wall_ns;
+	size_t fail;			/* failed in the last run */
+	size_t known;
+};
+
+/**
+ * @fn ut_test_key_table_build
+ * @brief (file, unique_id, name) -> test index table for the timing / history file;
+ * the line number disambiguates tests sharing the name (unnamed tests).
+ */
+static inline
+size_t ut_hash_test_key(
+	char const *file,
+	uint64_t unique_id,
+	char const *name)
+{
+	return(ut_hash_name(file) ^ (unique_id * 0x9e3779b97f4a7c15ULL) ^ (ut_hash_name(name) * 0xff51afd7ed558ccdULL));
+}
+
+#define ut_test_name(_t)		( (_t)->name == NULL ? "" : (_t)->name )
+
+static inline
+size_t *ut_test_key_table_build(
+	struct ut_s const *test,
+	size_t test_cnt,
+	size_t *mask)
+{
+	size_t size = 2 * test_cnt + 1;
+	utkv_roundup32(size);
+	*mask = size - 1;
+
+	size_t *slot = (size_t *)calloc(size, sizeof(size_t));
+	for(size_t i = 0; i < test_cnt; i++) {
+		size_t h = ut_hash_test_key(test[i].file, test[i].unique_id, ut_test_name(&test[i])) & *mask;
+		while(slot[h] != 0) { h = (h + 1) & *mask; }
+		slot[h] = i + 1;
+	}
+	return(slot);
+}
+
+static inline
+size_t ut_test_key_table_get(
+	size_t const *slot,
+	size_t mask,
+	struct ut_s const *test,
+	char const *file,
+	uint64_t unique_id,
+	size_t line,
+	char const *name)
+{
+	size_t found = 0;
+	size_t h = ut_hash_test_key(file, unique_id, name) & mask;
+	while(slot[h] != 0) {
+		struct ut_s const *t = &test[slot[h] - 1];
+		if(t->unique_id == unique_id && strcmp(t->file, file) == 0 && strcmp(ut_test_name(t), name) == 0) {
+			if(t->line == line) { return(slot[h]); }
+			if(found == 0) { found = slot[h]; }
+		}
+		h = (h + 1) & mask;
+	}
+	return(found);
+}
+
+/**
+ * @fn ut_load_records
+ * @brief read a timing / history file; lines are tab-separated `file, unique_id,
+ * line, name, wall_ns, failed'. unknown tests are ignored and later lines override
+ * the earlier ones, so the files of the shards can simply be concatenated.
+ * returns NULL on failure.
+ */
+static inline
+struct ut_record_s *ut_load_records(
+	char const *filename,
+	struct ut_s const *test,
+	size_t test_cnt)
+{
+	FILE *fp = fopen(filename, "r");
+	if(fp == NULL) {
+		if(errno != ENOENT) {
+			fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": failed to open `%s'.\n", filename);
+		}
+		return(NULL);
+	}
+
+	size_t mask;
+	size_t *slot = ut_test_key_table_build(test, test_cnt, &mask);
+	struct ut_record_s *rec = (struct ut_record_s *)calloc(test_cnt + 1, sizeof(struct ut_record_s));
+
+	char buf[4096];
+	while(fgets(buf, sizeof(buf), fp) != NULL) {
+		/* split into columns */
+		char *col[6] = { buf, NULL, NULL, NULL, NULL, NULL };
+		size_t k = 1;
+		for(char *p = buf; *p != '\0' && k < 6; p++) {
+			if(*p == '\t') { *p = '\0'; col[k++] = p + 1; }
+			if(*p == '\n') { *p = '\0'; break; }
+		}
+		if(k < 6) { continue; }
+
+		size_t id = ut_test_key_table_get(slot, mask, test,
+			col[0], strtoull(col[1], NULL, 10), (size_t)strtoull(col[2], NULL, 10), col[3]);
+		if(id == 0) { continue; }
+		rec[id - 1] = (struct ut_record_s){
+			.wall_ns = strtoull(col[4], NULL, 10),
+			.fail = strtoull(col[5], NULL, 10) != 0,
+			.known = 1
+		};
+	}
+
+	free(slot);
+	fclose(fp);
+	return(rec);
+}
+
+/**
+ * @fn ut_save_records
+ * @brief write the records of the tests executed; the previous records (prev,
+ * may be NULL) of the tests not executed are kept. the file is replaced atomically.
+ */
+static inline
+int ut_save_records(
+	char const *filename,
+	struct ut_s const *test,
+	size_t test_cnt,
+	struct ut_record_s const *prev)
+{
+	size_t const len = strlen(filename);
+	char tmp[len + 16];
+	snprintf(tmp, len + 16, "%s.tmp.%ld", filename, (long)getpid());
+
+	FILE *fp = fopen(tmp, "w");
+	if(fp == NULL) {
+		fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": failed to open `%s'.\n", tmp);
+		return(-1);
+	}
+	for(size_t i = 0; i < test_cnt; i++) {
+		struct ut_record_s r = { .wall_ns = test[i].wall_ns, .fail = test[i].fail != 0, .known = 1 };
+		if(test[i].exec == 0) {
+			if(prev == NULL || prev[i].known == 0) { continue; }
+			r = prev[i];
+		}
+		fprintf(fp, "%s\t%" PRIu64 "\t%" PRIu64 "\t%s\t%" PRIu64 "\t%zu\n",
+			test[i].file, (uint64_t)test[i].unique_id, (uint64_t)test[i].line, ut_test_name(&test[i]), r.wall_ns, r.fail);
+	}
+
+	if(fclose(fp) != 0 || rename(tmp, filename) != 0) {
+		fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": failed to write `%s'.\n", filename);
+		remove(tmp);
+		return(-1);
+	}
+	return(0);
+}
+
+/**
+ * @fn ut_uf_find
+ * @brief union-find with path halving
+ */
+static inline
+size_t ut_uf_find(
+	size_t *parent,
+	size_t x)
+{
+	while(parent[x] != x) {
+		parent[x] = parent[parent[x]];
+		x = parent[x];
+	}
+	return(x);
+}
+
+struct ut_shard_comp_s {
+	double weight;
+	size_t id;
+};
+
+static
+int ut_compare_shard_comp(
+	void const *_a,
+	void const *_b)
+{
+	struct ut_shard_comp_s const *a = (struct ut_shard_comp_s const *)_a;
+	struct ut_shard_comp_s const *b = (struct ut_shard_comp_s const *)_b;
+
+	/* heavier first, then in the test order */
+	if(a->weight != b->weight) { return(a->weight < b->weight ? 1 : -1); }
+	return(a->id < b->id ? -1 : (a->id > b->id ? 1 : 0));
+}
+
+/**
+ * @fn ut_shard_tests
+ * @brief keep only the tests of the shard; tests connected by test-level
+ * dependencies form a component that is never split, and the components are
+ * assigned greedily (heaviest first, to the lightest shard) by count or by the
+ * recorded duration, so the result depends only on the test set.
+ */
+static inline
+void ut_shard_tests(
+	struct ut_s *test,
+	size_t test_cnt,
+	struct ut_global_config_s const *gconf,
+	struct ut_record_s const *rec,
+	size_t const *file_idx,
+	size_t file_cnt)
+{
+	if(gconf->shard_count <= 1) { return; }
+
+	/* components within each group */
+	size_t *parent = (size_t *)malloc(sizeof(size_t) * (test_cnt + 1));
+	for(size_t i = 0; i < test_cnt; i++) { parent[i] = i; }
+	for(size_t g = 0; g < file_cnt; g++) {
+		struct ut_dag_s dag;
+		ut_dag_build(&dag, &test[file_idx[g]], sizeof(struct ut_s), file_idx[g + 1] - file_idx[g]);
+		for(size_t i = 0; i < dag.cnt; i++) {
+			for(size_t e = dag.head[i]; e < dag.head[i + 1]; e++) {
+				size_t a = ut_uf_find(parent, file_idx[g] + i), b = ut_uf_find(parent, file_idx[g] + dag.adj[e]);
+				if(a != b) { parent[a > b ? a : b] = a < b ? a : b; }
+			}
+		}
+		ut_dag_destroy(&dag);
+	}
+
+	/* weights; tests without records are given the mean of the recorded ones */
+	uint64_t known_sum = 0, known_cnt = 0;
+	for(size_t i = 0; rec != NULL && i < test_cnt; i++) {
+		if(test[i].exec != 0 && rec[i].known != 0) { known_sum += rec[i].wall_ns; known_cnt++; }
+	}
+	uint64_t const mean = known_cnt == 0 ? 1 : known_sum / known_cnt + 1;
+
+	double *weight = (double *)calloc(test_cnt + 1, sizeof(double));
+	for(size_t i = 0; i < test_cnt; i++) {
+		if(test[i].exec == 0) { continue; }
+		uint64_t w = rec == NULL ? 1 : (rec[i].known != 0 ? rec[i].wall_ns + 1 : mean);
+		weight[ut_uf_find(parent, i)] += (double)w;
+	}
+
+	/* components (represented by the smallest index) ordered by weight */
+	utkvec_t(struct ut_shard_comp_s) comp;
+	utkv_init(comp);
+	for(size_t i = 0; i < test_cnt; i++) {
+		if(parent[i] == i && weight[i] > 0.0) {
+			utkv_push(comp, ((struct ut_shard_comp_s){ .weight = weight[i], .id = i }));
+		}
+	}
+	qsort(utkv_ptr(comp), utkv_size(comp), sizeof(struct ut_shard_comp_s), ut_compare_shard_comp);
+
+	/* longest processing time first */
+	double *load = (double *)calloc(gconf->shard_count, sizeof(double));
+	size_t *shard = (size_t *)malloc(sizeof(size_t) * (test_cnt + 1));
+	for(size_t i = 0; i < utkv_size(comp); i++) {
+		size_t min = 0;
+		for(size_t s = 1; s < gconf->shard_count; s++) {
+			if(load[s] < load[min]) { min = s; }
+		}
+		load[min] += utkv_at(comp, i).weight;
+		shard[utkv_at(comp, i).id] = min;
+	}
+
+	for(size_t i = 0; i < test_cnt; i++) {
+		if(test[i].exec == 0) { continue; }
+		if(shard[ut_uf_find(parent, i)] != gconf->shard_index) { test[i].exec = 0; }
+	}
+
+	free(shard);
+	free(load);
+	utkv_destroy(comp);
+	free(weight);
+	free(parent);
+	return;
+}
+
+/**
+ * @fn ut_default_cache_file
+ * @brief `<executable>.utcache'
+ */
+static inline
+char *ut_default_cache_file(
+	char const *filename)
+{
+	size_t const len = strlen(filename);
+	char *path = (char *)malloc(len + 16);
+	memcpy(path, filename, len);
+	strcpy(path + len, ".utcache");
+	return(path);
+}
+
+/**
+ * @fn ut_load_hash_cache
+ * @brief code hashes of the tests passed in the previous runs (--changed-only);
+ * lines are tab-separated `file, unique_id, line, name, hash'. 0 for unknown tests.
+ */
+static inline
+uint64_t *ut_load_hash_cache(
+	char const *filename,
+	struct ut_s const *test,
+	size_t test_cnt)
+{
+	uint64_t *hash = (uint64_t *)calloc(test_cnt + 1, sizeof(uint64_t));
+	FILE *fp = fopen(filename, "r");
+	if(fp == NULL) { return(hash); }
+
+	size_t mask;
+	size_t *slot = ut_test_key_table_build(test, test_cnt, &mask);
+
+	char buf[4096];
+	while(fgets(buf, sizeof(buf), fp) != NULL) {
+		char *col[5] = { buf, NULL, NULL, NULL, NULL };
+		size_t k = 1;
+		for(char *p = buf; *p != '\0' && k < 5; p++) {
+			if(*p == '\t') { *p = '\0'; col[k++] = p + 1; }
+			if(*p == '\n') { *p = '\0'; break; }
+		}
+		if(k < 5) { continue; }
+
+		size_t id = ut_test_key_table_get(slot, mask, test,
+			col[0], strtoull(col[1], NULL, 10), (size_t)strtoull(col[2], NULL, 10), col[3]);
+		if(id != 0) { hash[id - 1] = strtoull(col[4], NULL, 16); }
+	}
+
+	free(slot);
+	fclose(fp);
+	return(hash);
+}
+
+/**
+ * @fn ut_save_hash_cache
+ * @brief tests passed in this run are stored with the current hash, those failed
+ * are dropped, and the others keep the previous one. replaced atomically.
+ */
+static inline
+int ut_save_hash_cache(
+	char const *filename,
+	struct ut_s const *test,
+	size_t test_cnt,
+	uint64_t const *prev,
+	uint64_t const *curr)
+{
+	size_t const len = strlen(filename);
+	char tmp[len + 16];
+	snprintf(tmp, len + 16, "%s.tmp.%ld", filename, (long)getpid());
+
+	FILE *fp = fopen(tmp, "w");
+	if(fp == NULL) {
+		fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": failed to open `%s'.\n", tmp);
+		return(-1);
+	}
+	for(size_t i = 0; i < test_cnt; i++) {
+		uint64_t h = test[i].exec == 0 ? prev[i] : (test[i].fail == 0 ? curr[i] : 0);
+		if(h == 0) { continue; }
+		fprintf(fp, "%s\t%" PRIu64 "\t%" PRIu64 "\t%s\t%016" PRIx64 "\n",
+			test[i].file, (uint64_t)test[i].unique_id, (uint64_t)test[i].line, ut_test_name(&test[i]), h);
+	}
+
+	if(fclose(fp) != 0 || rename(tmp, filename) != 0) {
+		fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": failed to write `%s'.\n", filename);
+		remove(tmp);
+		return(-1);
+	}
+	return(0);
+}
+
+/**
+ * @fn ut_hash_tests
+ * @brief code hash of each test: the body, its init / clean, the init / clean
+ * of the group, and everything they call directly. NULL when the code cannot be
+ * located (non-ELF platforms).
+ */
+static inline
+uint64_t *ut_hash_tests(
+	char const *filename,
+	struct ut_s const *test,
+	size_t test_cnt,
+	struct ut_group_config_s const *compd_config)
+{
+	struct ut_code_s code;
+	if(ut_code_build(&code, filename) != 0) {
+		return(NULL);
+	}
+
+	uint64_t *hash = (uint64_t *)calloc(test_cnt + 1, sizeof(uint64_t));
+	for(size_t i = 0; i < test_cnt; i++) {
+		struct ut_group_config_s const *c = &compd_config[test[i].index];
+		void const *root[5] = {
+			(void const *)test[i].fn,
+			(void const *)test[i].init, (void const *)test[i].clean,
+			(void const *)c->init, (void const *)c->clean
+		};
+		hash[i] = ut_code_hash(&code, root, 5) | 1;
+	}
+	ut_code_destroy(&code);
+	return(hash);
+}
+
+/**
+ * @fn ut_select_changed
+ * @brief unselect the tests whose hash matches the cache, unless one of their
+ * test-level or group-level predecessors is to run. returns the number of tests unselected.
+ */
+static inline
+size_t ut_select_changed(
+	struct ut_s *test,
+	size_t test_cnt,
+	struct ut_group_config_s const *compd_config,
+	uint64_t const *prev,
+	uint64_t const *curr,
+	size_t const *file_idx,
+	size_t file_cnt)
+{
+	uint8_t *dirty = (uint8_t *)calloc(test_cnt + 2 * file_cnt + 1, sizeof(uint8_t));
+	uint8_t *gin = &dirty[test_cnt], *gout = &dirty[test_cnt + file_cnt];	/* predecessor group to run, group to run */
+
+	struct ut_dag_s gdag;
+	ut_dag_build(&gdag, compd_config, sizeof(struct ut_group_config_s), file_cnt);
+
+	/* groups and tests are in the topological order */
+	for(size_t g = 0; g < file_cnt; g++) {
+		struct ut_dag_s dag;
+		ut_dag_build(&dag, &test[file_idx[g]], sizeof(struct ut_s), file_idx[g + 1] - file_idx[g]);
+		for(size_t i = file_idx[g]; i < file_idx[g + 1]; i++) {
+			dirty[i] |= gin[g] | (prev[i] != curr[i]);
+			gout[g] |= dirty[i];
+
+			/* propagate to the successors in the group */
+			size_t const l = i - file_idx[g];
+			for(size_t e = dag.head[l]; e < dag.head[l + 1] && dirty[i]; e++) {
+				dirty[file_idx[g] + dag.adj[e]] = 1;
+			}
+		}
+		ut_dag_destroy(&dag);
+
+		for(size_t e = gdag.head[g]; e < gdag.head[g + 1] && gout[g]; e++) {
+			gin[gdag.adj[e]] = 1;
+		}
+	}
+	ut_dag_destroy(&gdag);
+
+	size_t skipped = 0;
+	for(size_t i = 0; i < test_cnt; i++) {
+		if(test[i].exec == 0 || dirty[i] != 0) { continue; }
+		test[i].exec = 0;
+		skipped++;
+	}
+	free(dirty);
+	return(skipped);
+}
+
+/**
+ * @struct ut_group_state_s
+ * @brief lazily initialized group context, shared by the tests in the group
+ */
+struct ut_group_state_s {
+	pthread_mutex_t lock;
+	int initialized;
+	void *gctx;
+	size_t remaining;		/* selected tests not finished yet */
+};
+
+/**
+ * @fn ut_group_state_init
+ * @brief count selected tests; groups without them are never initialized
+ */
+static inline
+struct ut_group_state_s *ut_group_state_init(
+	struct ut_s const *test,
+	size_t test_cnt,
+	size_t file_cnt)
+{
+	struct ut_group_state_s *gstate = (struct ut_group_state_s *)calloc(file_cnt + 1, sizeof(struct ut_group_state_s));
+	for(size_t i = 0; i < file_cnt; i++) {
+		pthread_mutex_init(&gstate[i].lock, NULL);
+	}
+	for(size_t i = 0; i < test_cnt; i++) {
+		if(test[i].exec != 0) { gstate[test[i].index].remaining++; }
+	}
+	return(gstate);
+}
+
+static inline
+void ut_group_state_destroy(
+	struct ut_group_state_s *gstate,
+	size_t file_cnt)
+{
+	for(size_t i = 0; i < file_cnt; i++) {
+		pthread_mutex_destroy(&gstate[i].lock);
+	}
+	free(gstate);
+	return;
+}
+
+/**
+ * @fn ut_group_acquire
+ * @brief create the group context on the first call
+ */
+static inline
+void *ut_group_acquire(
+	struct ut_group_state_s *gs,
 	struct ut_group_config_s const *config)
 {
-	struct ut_group_config_s const *c = config;
-	while(c->file != NULL) {
-		printf("%s, %zu, %s, %s, %p, %p\n",
-			c->file,
-			c->unique_id,
-			c->name,
-			c->depends_on[0],
-			(void *)c->init,
-			(void *)c->clean);
-		c++;
+	if(__atomic_load_n(&gs->initialized, __ATOMIC_ACQUIRE) != 0) {
+		return(gs->gctx);
+	}
+
+	pthread_mutex_lock(&gs->lock);
+	if(gs->initialized == 0) {
+		if(config->init != NULL && config->clean != NULL) {
+			gs->gctx = config->init(config->params);
+		}
+		__atomic_store_n(&gs->initialized, 1, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&gs->lock);
+	return(gs->gctx);
+}
+
+/**
+ * @fn ut_group_release
+ * @brief tear down the group context after the last selected test
+ */
+static inline
+void ut_group_release(
+	struct ut_group_state_s *gs,
+	struct ut_group_config_s const *config)
+{
+	if(__atomic_sub_fetch(&gs->remaining, 1, __ATOMIC_ACQ_REL) != 0) { return; }
+
+	if(config->init != NULL && config->clean != NULL) {
+		config->clean(gs->gctx);
+	}
+	gs->gctx = NULL;
+	gs->initialized = 0;
+	return;
+}
+
+/**
+ * @fn ut_now_ns
+ */
+#ifdef CLOCK_MONOTONIC_RAW
+#  define UT_BENCH_CLOCK		CLOCK_MONOTONIC_RAW
+#else
+#  define UT_BENCH_CLOCK		CLOCK_MONOTONIC
+#endif
+
+static inline
+uint64_t ut_now_ns(
+	clockid_t clk)
+{
+	struct timespec ts;
+	clock_gettime(clk, &ts);
+	return((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+#ifndef UNITTEST_BENCH_SAMPLES
+#define UNITTEST_BENCH_SAMPLES		( 21 )
+#endif
+
+static
+int ut_compare_double(
+	void const *_a,
+	void const *_b)
+{
+	double const a = *(double const *)_a, b = *(double const *)_b;
+	return((a > b) - (a < b));
+}
+
+static inline
+double ut_median(
+	double *v,
+	size_t cnt)
+{
+	qsort(v, cnt, sizeof(double), ut_compare_double);
+	return((cnt & 0x01) ? v[cnt / 2] : 0.5 * (v[cnt / 2 - 1] + v[cnt / 2]));
+}
+
+/**
+ * @fn ut_run_bench
+ * @brief calibrate the iteration count to the target duration, warm up, then take samples
+ */
+static
+void ut_run_bench(
+	struct ut_s *test,
+	void *ctx,
+	void *gctx,
+	struct ut_arena_s *arena,
+	struct ut_global_config_s const *gconf,
+	struct ut_group_config_s const *config)
+{
+	#define ut_bench_batch(_iters) ({ \
+		uint64_t _b = ut_now_ns(UT_BENCH_CLOCK); \
+		for(size_t _i = 0; _i < (_iters); _i++) { \
+			test->fn(ctx, gctx, arena, test, gconf, config); \
+			ut_arena_reset(arena); \
+		} \
+		ut_now_ns(UT_BENCH_CLOCK) - _b; \
+	})
+
+	/* checking run; assertions are counted only here */
+	test->fn(ctx, gctx, arena, test, gconf, config);
+	ut_arena_reset(arena);
+	size_t const succ = test->succ, fail = test->fail;
+	if(fail != 0) { return; }
+
+	/* calibrate (doubles as warmup); the arena is not poisoned in the timed batches */
+	arena->no_poison = 1;
+	uint64_t const target = (uint64_t)(gconf->bench_time_ms != 0 ? gconf->bench_time_ms : 10) * 1000000ULL;
+	size_t iters = 1;
+	uint64_t elapsed;
+	while((elapsed = ut_bench_batch(iters)) < target) {
+		double scale = elapsed == 0 ? 10.0 : 1.2 * (double)target / (double)elapsed;
+		iters = (size_t)((double)iters * (scale < 2.0 ? 2.0 : (scale > 10.0 ? 10.0 : scale)));
+	}
+	ut_bench_batch(iters);		/* warmup at the calibrated count */
+
+	/* sample */
+	double ns[UNITTEST_BENCH_SAMPLES], dev[UNITTEST_BENCH_SAMPLES];
+	for(size_t i = 0; i < UNITTEST_BENCH_SAMPLES; i++) {
+		ns[i] = (double)ut_bench_batch(iters) / (double)iters;
+	}
+	double const med = ut_median(ns, UNITTEST_BENCH_SAMPLES);
+	for(size_t i = 0; i < UNITTEST_BENCH_SAMPLES; i++) {
+		dev[i] = ns[i] > med ? ns[i] - med : med - ns[i];
+	}
+
+	#undef ut_bench_batch
+	arena->no_poison = 0;
+
+	/* restore counters of the checking run */
+	test->succ = succ;
+	test->fail = fail;
+
+	struct ut_bench_result_s result = {
+		.ns_per_op = med,
+		.mad = ut_median(dev, UNITTEST_BENCH_SAMPLES),
+		.iterations = iters,
+		.samples = UNITTEST_BENCH_SAMPLES
+	};
+	gconf->printer.bench(test, gconf, config, &result);
+	return;
+}
+
+/**
+ * @fn ut_signal_name
+ */
+static inline
+char const *ut_signal_name(
+	int sig)
+{
+	switch(sig) {
+		case SIGSEGV: return("SIGSEGV");
+		case SIGBUS: return("SIGBUS");
+		case SIGFPE: return("SIGFPE");
+		case SIGILL: return("SIGILL");
+		case SIGABRT: return("SIGABRT");
+		case SIGKILL: return("SIGKILL");
+		case SIGTERM: return("SIGTERM");
+		case SIGPIPE: return("SIGPIPE");
+		case SIGTRAP: return("SIGTRAP");
+		default: return("unknown signal");
+	}
+}
+
+/**
+ * @brief in-process crash recovery (--catch-signals); a synchronous fault in
+ * the test body jumps back to ut_run_guarded on the per-thread alternate stack.
+ */
+#ifndef UNITTEST_ALTSTACK_SIZE
+#define UNITTEST_ALTSTACK_SIZE		( 64 * 1024 )
+#endif
+
+static __thread sigjmp_buf *volatile ut_catch_jmp;
+static __thread int ut_catch_sig;
+static __thread void *ut_catch_addr;
+
+#if UT_HAVE_CATCH
+static __thread void *ut_catch_stack;
+
+static
+void ut_catch_handler(
+	int sig,
+	siginfo_t *si,
+	void *uctx)
+{
+	(void)uctx;
+	sigjmp_buf *jb = ut_catch_jmp;
+	if(jb == NULL) {
+		/* not in a test body; die as usual on return or re-raise */
+		signal(sig, SIG_DFL);
+		if(si->si_code <= 0) { raise(sig); }
+		return;
+	}
+	ut_catch_jmp = NULL;
+	ut_catch_sig = sig;
+	ut_catch_addr = si->si_addr;
+	siglongjmp(*jb, 1);
+}
+#endif
+
+/**
+ * @fn ut_catch_install
+ * @brief install the handler process-wide; SA_NODEFER keeps the signal
+ * unblocked after the jump, so sigsetjmp does not need to save the mask.
+ */
+static inline
+void ut_catch_install(void)
+{
+#if UT_HAVE_CATCH
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(struct sigaction));
+	sa.sa_sigaction = ut_catch_handler;
+	sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_NODEFER;
+	sigemptyset(&sa.sa_mask);
+
+	int const sigs[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL };
+	for(size_t i = 0; i < sizeof(sigs) / sizeof(int); i++) {
+		sigaction(sigs[i], &sa, NULL);
+	}
+#endif
+	return;
+}
+
+/**
+ * @fn ut_catch_thread_init, ut_catch_thread_destroy
+ * @brief alternate signal stack of the calling thread, so that stack overflows are caught as well
+ */
+static inline
+void ut_catch_thread_init(void)
+{
+#if UT_HAVE_CATCH
+	if(ut_catch_stack != NULL) { return; }
+	ut_catch_stack = malloc(UNITTEST_ALTSTACK_SIZE);
+
+	stack_t ss = {
+		.ss_sp = ut_catch_stack,
+		.ss_size = UNITTEST_ALTSTACK_SIZE,
+		.ss_flags = 0
+	};
+	sigaltstack(&ss, NULL);
+#endif
+	return;
+}
+
+static inline
+void ut_catch_thread_destroy(void)
+{
+#if UT_HAVE_CATCH
+	if(ut_catch_stack == NULL) { return; }
+
+	stack_t ss = { .ss_flags = SS_DISABLE };
+	sigaltstack(&ss, NULL);
+	free(ut_catch_stack);
+	ut_catch_stack = NULL;
+#endif
+	return;
+}
+
+/**
+ * per-thread arena handed to the test bodies (ut_alloc); reset after each test
+ */
+static __thread struct ut_arena_s ut_test_arena;
+
+/**
+ * @fn ut_run_body
+ */
+static inline
+void ut_run_body(
+	struct ut_s *test,
+	void *ctx,
+	void *gctx,
+	struct ut_arena_s *arena,
+	struct ut_global_config_s const *gconf,
+	struct ut_group_config_s const *config)
+{
+	if(test->bench != 0) {
+		ut_run_bench(test, ctx, gctx, arena, gconf, config);
+	} else {
+		test->fn(ctx, gctx, arena, test, gconf, config);
+	}
+	return;
+}
+
+/**
+ * @fn ut_run_guarded
+ * @brief run the body with the jump buffer armed; returns the signal caught, 0 if none
+ */
+static __attribute__(( noinline ))
+int ut_run_guarded(
+	struct ut_s *test,
+	void *ctx,
+	void *gctx,
+	struct ut_arena_s *arena,
+	struct ut_global_config_s const *gconf,
+	struct ut_group_config_s const *config)
+{
+	sigjmp_buf jb;
+	if(sigsetjmp(jb, 0) != 0) {
+		return(ut_catch_sig);
+	}
+	ut_catch_jmp = &jb;
+	ut_run_body(test, ctx, gctx, arena, gconf, config);
+	ut_catch_jmp = NULL;
+	return(0);
+}
+
+/**
+ * @fn ut_run_test
+ */
+static
+void ut_run_test(
+	struct ut_s *test,
+	struct ut_global_config_s const *gconf,
+	struct ut_group_config_s const *compd_config,
+	struct ut_group_state_s *gstate)
+{
+	if(test->exec == 0) { return; }
+	size_t index = test->index;
+
+	/* get group context */
+	void *gctx = ut_group_acquire(&gstate[index], &compd_config[index]);
+
+	/* initialize local context */
+	void *ctx = NULL;
+	if(test->init != NULL && test->clean != NULL) {
+		ctx = test->init(test->params);
+	}
+
+	/* run a test */
+	uint64_t const cpu = ut_now_ns(CLOCK_THREAD_CPUTIME_ID), wall = ut_now_ns(CLOCK_MONOTONIC);
+	if(gconf->catch_signals == 0) {
+		ut_run_body(test, ctx, gctx, &ut_test_arena, gconf, &compd_config[index]);
+	} else {
+		ut_catch_thread_init();
+		int sig = ut_run_guarded(test, ctx, gctx, &ut_test_arena, gconf, &compd_config[index]);
+		if(sig != 0) {
+			ut_test_arena.no_poison = 0;		/* may have jumped out of a benchmark */
+			test->fail++;
+			gconf->printer.failed(test, gconf, &compd_config[index], test->line, "", "(crashed)",
+				"caught %s at address %p", ut_signal_name(sig), ut_catch_addr);
+		}
+	}
+	test->wall_ns = ut_now_ns(CLOCK_MONOTONIC) - wall;
+	test->cpu_ns = ut_now_ns(CLOCK_THREAD_CPUTIME_ID) - cpu;
+
+	/* cleanup contexts */
+	if(test->init != NULL && test->clean != NULL) {
+		test->clean(ctx);
+	}
+	ut_group_release(&gstate[index], &compd_config[index]);
+	ut_arena_reset(&ut_test_arena);
+	return;
+}
+
+/**
+ * @struct ut_queue_s
+ * @brief per-worker ready queue; a min-heap on the node rank (the index unless
+ * --history is given), so that the owner runs tests in the sorted order and
+ * thieves take the earliest ones.
+ */
+struct ut_queue_s {
+	pthread_mutex_t lock;
+	size_t cnt;
+	size_t *heap;
+};
+
+/**
+ * @struct ut_out_s
+ * @brief messages of a finished test, held until the preceding tests are flushed
+ */
+struct ut_out_s {
+	char *buf;
+	size_t len;
+	int done;
+};
+
+/**
+ * @struct ut_watch_s
+ * @brief test in flight on a worker; node_id is (size_t)-1 when idle
+ */
+struct ut_watch_s {
+	size_t node_id;
+	uint64_t start_ns;
+};
+
+/**
+ * @struct ut_sched_s
+ * @brief dependency-aware scheduler; tests are nodes [0, test_cnt), and every
+ * group has a barrier node in [test_cnt, node_cnt) completed after its last test.
+ */
+struct ut_sched_s {
+	/* graph */
+	size_t test_cnt, node_cnt;
+	struct ut_dag_s dag;
+	size_t *pending;		/* unfinished predecessors of each node */
+
+	/* pool state */
+	size_t remaining;		/* nodes not completed yet */
+	size_t queued;			/* nodes in the queues */
+	size_t sleeping;
+	pthread_mutex_t idle_lock;
+	pthread_cond_t idle_cond;
+
+	size_t worker_cnt;
+	struct ut_queue_s *queue;
+	size_t *rank, *order;	/* queues hold ranks; order[rank[i]] == i */
+
+	/* tests */
+	struct ut_s *test;
+	struct ut_global_config_s const *gconf;
+	struct ut_group_config_s const *compd_config;
+	size_t file_cnt;
+	struct ut_group_state_s *gstate;
+
+	/* buffered output in the test order (gconf->ordered != 0) */
+	pthread_mutex_t out_lock;
+	size_t out_cursor;		/* tests before this are flushed */
+	struct ut_out_s *out;
+
+	/* tests running on each worker, watched for timeouts */
+	struct ut_watch_s *watch;
+
+	/* fail-fast */
+	size_t failed;			/* tests failed so far */
+	int cancelled;			/* no more tests are started once set */
+};
+
+struct ut_worker_s {
+	struct ut_sched_s *sched;
+	size_t id;
+	pthread_t th;
+};
+
+/**
+ * @fn ut_sched_build_graph
+ * @brief merge test-level (per group) and group-level dependencies into one graph
+ */
+static inline
+void ut_sched_build_graph(
+	struct ut_sched_s *sched,
+	struct ut_s const *test,
+	size_t test_cnt,
+	struct ut_group_config_s const *compd_config,
+	size_t const *file_idx,
+	size_t file_cnt)
+{
+	utkvec_t(size_t) edge;
+	utkv_init(edge);
+
+	/* test-level edges and edges to the group barriers */
+	for(size_t g = 0; g < file_cnt; g++) {
+		struct ut_dag_s dag;
+		ut_dag_build(&dag, &test[file_idx[g]], sizeof(struct ut_s), file_idx[g + 1] - file_idx[g]);
+		for(size_t i = 0; i < dag.cnt; i++) {
+			for(size_t e = dag.head[i]; e < dag.head[i + 1]; e++) {
+				utkv_push(edge, file_idx[g] + i);
+				utkv_push(edge, file_idx[g] + dag.adj[e]);
+			}
+			utkv_push(edge, file_idx[g] + i);
+			utkv_push(edge, test_cnt + g);
+		}
+		ut_dag_destroy(&dag);
+	}
+
+	/* group-level edges: from the barrier of the predecessor to every test in the group */
+	struct ut_dag_s gdag;
+	ut_dag_build(&gdag, compd_config, sizeof(struct ut_group_config_s), file_cnt);
+	for(size_t g = 0; g < file_cnt; g++) {
+		for(size_t e = gdag.head[g]; e < gdag.head[g + 1]; e++) {
+			size_t h = gdag.adj[e];
+			for(size_t j = file_idx[h]; j < file_idx[h + 1]; j++) {
+				utkv_push(edge, test_cnt + g);
+				utkv_push(edge, j);
+			}
+		}
 	}
+	ut_dag_destroy(&gdag);
+
+	sched->test_cnt = test_cnt;
+	sched->node_cnt = test_cnt + file_cnt;
+	ut_dag_pack(&sched->dag, sched->node_cnt, utkv_ptr(edge), utkv_size(edge) / 2);
+	sched->pending = sched->dag.indeg;
+
+	utkv_destroy(edge);
 	return;
 }
 
+struct ut_sched_prio_s {
+	size_t fail;
+	uint64_t blevel;
+	size_t id;
+};
+
 static
-int ut_compare(
+int ut_compare_sched_prio(
 	void const *_a,
 	void const *_b)
 {
-	struct ut_s const *a = (struct ut_s const *)_a;
-	struct ut_s const *b = (struct ut_s const *)_b;
-
-	int64_t comp_res = 0;
-	/* first sort by file name */
-	if((comp_res = ut_strcmp(a->file, b->file)) != 0) {
-		return(comp_res);
-	}
+	struct ut_sched_prio_s const *a = (struct ut_sched_prio_s const *)_a;
+	struct ut_sched_prio_s const *b = (struct ut_sched_prio_s const *)_b;
 
-	#define sat(a)	( ((a) > INT32_MAX) ? INT32_MAX : (((a) < INT32_MIN) ? INT32_MIN : (a)) )
+	/* failed last time, then on a longer path, then in the test order */
+	if(a->fail != b->fail) { return(a->fail > b->fail ? -1 : 1); }
+	if(a->blevel != b->blevel) { return(a->blevel > b->blevel ? -1 : 1); }
+	return(a->id < b->id ? -1 : (a->id > b->id ? 1 : 0));
+}
 
-	if((comp_res = (int64_t)(a->unique_id - b->unique_id)) != 0) {
-		return(sat(comp_res));
+/**
+ * @fn ut_sched_build_rank
+ * @brief priorities of the nodes. without history the rank is the node index.
+ * with history, tests failed in the last run come first, then those heading the
+ * longest remaining path (bottom level on the recorded durations, which reduces
+ * to longest-processing-time-first for independent tests).
+ */
+static inline
+void ut_sched_build_rank(
+	struct ut_sched_s *sched,
+	struct ut_record_s const *rec)
+{
+	size_t const n = sched->node_cnt;
+	sched->rank = (size_t *)malloc(sizeof(size_t) * (n + 1));
+	sched->order = (size_t *)malloc(sizeof(size_t) * (n + 1));
+	for(size_t i = 0; i < n; i++) { sched->rank[i] = sched->order[i] = i; }
+	if(rec == NULL) { return; }
+
+	/* topological order of the whole graph */
+	struct ut_dag_s const *dag = &sched->dag;
+	size_t *indeg = (size_t *)malloc(sizeof(size_t) * (n + 1));
+	size_t *topo = (size_t *)malloc(sizeof(size_t) * (n + 1));
+	size_t head = 0, tail = 0;
+	memcpy(indeg, dag->indeg, sizeof(size_t) * n);
+	for(size_t i = 0; i < n; i++) {
+		if(indeg[i] == 0) { topo[tail++] = i; }
+	}
+	while(head < tail) {
+		size_t v = topo[head++];
+		for(size_t e = dag->head[v]; e < dag->head[v + 1]; e++) {
+			if(--indeg[dag->adj[e]] == 0) { topo[tail++] = dag->adj[e]; }
+		}
 	}
 
-	#undef sat
-
-	/* third sort by name */
-	if((comp_res = ut_strcmp(a->name, b->name)) != 0) {
-		return(comp_res);
+	/* unrecorded tests are given the mean */
+	uint64_t sum = 0, cnt = 0;
+	for(size_t i = 0; i < sched->test_cnt; i++) {
+		if(rec[i].known != 0) { sum += rec[i].wall_ns; cnt++; }
+	}
+	uint64_t const mean = cnt == 0 ? 0 : sum / cnt;
+
+	/* bottom levels in the reverse order */
+	struct ut_sched_prio_s *prio = (struct ut_sched_prio_s *)calloc(n + 1, sizeof(struct ut_sched_prio_s));
+	for(size_t k = tail; k > 0; k--) {
+		size_t v = topo[k - 1];
+		uint64_t succ = 0;
+		for(size_t e = dag->head[v]; e < dag->head[v + 1]; e++) {
+			if(prio[dag->adj[e]].blevel > succ) { succ = prio[dag->adj[e]].blevel; }
+		}
+		uint64_t w = 0;
+		if(v < sched->test_cnt && sched->test[v].exec != 0) {
+			w = rec[v].known != 0 ? rec[v].wall_ns : mean;
+		}
+		prio[v] = (struct ut_sched_prio_s){
+			.fail = v < sched->test_cnt && rec[v].fail != 0,
+			.blevel = w + succ,
+			.id = v
+		};
+	}
+	qsort(prio, n, sizeof(struct ut_sched_prio_s), ut_compare_sched_prio);
+	for(size_t i = 0; i < n; i++) {
+		sched->order[i] = prio[i].id;
+		sched->rank[prio[i].id] = i;
 	}
 
-	/* last, sort by line number */
-	return((int)(a->line - b->line));
+	free(prio);
+	free(topo);
+	free(indeg);
+	return;
 }
 
+/**
+ * @fn ut_sched_push
+ */
 static inline
-int ut_match(
-	void const *_a,
-	void const *_b)
+void ut_sched_push(
+	struct ut_sched_s *sched,
+	size_t wid,
+	size_t node_id)
 {
-	struct ut_s const *a = (struct ut_s *)_a;
-	struct ut_s const *b = (struct ut_s *)_b;
-	return((ut_strcmp(a->file, b->file) == 0 && a->unique_id == b->unique_id) ? 0 : 1);
+	/* count first so that queued never underflows; a woken worker retries until the node appears */
+	pthread_mutex_lock(&sched->idle_lock);
+	sched->queued++;
+	if(sched->sleeping > 0) { pthread_cond_signal(&sched->idle_cond); }
+	pthread_mutex_unlock(&sched->idle_lock);
+
+	struct ut_queue_s *q = &sched->queue[wid];
+	pthread_mutex_lock(&q->lock);
+	ut_heap_push(q->heap, &q->cnt, sched->rank[node_id]);
+	pthread_mutex_unlock(&q->lock);
+	return;
 }
 
+/**
+ * @fn ut_sched_pop
+ * @brief pop from the own queue, then steal from the others
+ */
 static inline
-size_t ut_get_total_test_count(
-	struct ut_s const *test)
+int ut_sched_pop(
+	struct ut_sched_s *sched,
+	size_t wid,
+	size_t *node_id)
 {
-	size_t cnt = 0;
-	struct ut_s const *t = test;
-	while(t->file != NULL) { t++; cnt++; }
-	return(cnt);
+	for(size_t k = 0; k < sched->worker_cnt; k++) {
+		struct ut_queue_s *q = &sched->queue[(wid + k) % sched->worker_cnt];
+
+		pthread_mutex_lock(&q->lock);
+		int found = q->cnt > 0;
+		if(found) { *node_id = sched->order[ut_heap_pop(q->heap, &q->cnt)]; }
+		pthread_mutex_unlock(&q->lock);
+
+		if(found) {
+			pthread_mutex_lock(&sched->idle_lock);
+			sched->queued--;
+			pthread_mutex_unlock(&sched->idle_lock);
+			return(1);
+		}
+	}
+	return(0);
 }
 
+/**
+ * @fn ut_sched_complete
+ * @brief release successors of the node; group barriers are completed inline
+ */
 static inline
-size_t ut_get_total_config_count(
-	struct ut_group_config_s const *config)
+void ut_sched_complete(
+	struct ut_sched_s *sched,
+	size_t wid,
+	size_t node_id)
 {
-	size_t cnt = 0;
-	struct ut_group_config_s const *c = config;
-	while(c->file != NULL) { c++; cnt++; }
-	return(cnt);
+	struct ut_dag_s const *dag = &sched->dag;
+	for(size_t e = dag->head[node_id]; e < dag->head[node_id + 1]; e++) {
+		size_t s = dag->adj[e];
+		if(__atomic_sub_fetch(&sched->pending[s], 1, __ATOMIC_ACQ_REL) != 0) { continue; }
+
+		if(s >= sched->test_cnt) {
+			ut_sched_complete(sched, wid, s);
+		} else {
+			ut_sched_push(sched, wid, s);
+		}
+	}
+
+	if(__atomic_sub_fetch(&sched->remaining, 1, __ATOMIC_ACQ_REL) == 0) {
+		pthread_mutex_lock(&sched->idle_lock);
+		pthread_cond_broadcast(&sched->idle_cond);
+		pthread_mutex_unlock(&sched->idle_lock);
+	}
+	return;
 }
 
+/**
+ * @fn ut_sched_emit
+ * @brief flush the messages of the test; in ordered mode, hold them until all the preceding tests are flushed
+ */
 static inline
-size_t ut_get_total_file_count(
-	struct ut_s const *sorted_test)
+void ut_sched_emit(
+	struct ut_sched_s *sched,
+	size_t node_id)
 {
-	size_t cnt = 1;
-	struct ut_s const *t = sorted_test;
-
-	if(t++->file == NULL) {
-		return(0);
+	if(sched->gconf->ordered == 0) {
+		ut_out_flush(sched->gconf);
+		__atomic_store_n(&sched->out[node_id].done, 1, __ATOMIC_RELEASE);
+		return;
 	}
 
-	while(t->file != NULL) {
-		// printf("comp %s and %s\n", (t - 1)->file, t->file);
-		if(ut_match((void *)(t - 1), (void *)t) != 0) {
-			cnt++;
-		}
-		t++;
+	size_t len;
+	char *buf = ut_out_take(&len);
+
+	/* published under the lock; the watchdog reads held messages while workers run */
+	pthread_mutex_lock(&sched->out_lock);
+	struct ut_out_s *o = &sched->out[node_id];
+	o->buf = buf;
+	o->len = len;
+	__atomic_store_n(&o->done, 1, __ATOMIC_RELEASE);
+	while(sched->out_cursor < sched->test_cnt && sched->out[sched->out_cursor].done != 0) {
+		o = &sched->out[sched->out_cursor++];
+		ut_out_write(sched->gconf->fp, o->buf, o->len);
+		free(o->buf); o->buf = NULL;
 	}
-	return(cnt);
+	pthread_mutex_unlock(&sched->out_lock);
+	return;
 }
 
+/**
+ * @fn ut_sched_check_failure
+ * @brief count the failed test, and cancel the run at the --fail-fast threshold.
+ * tests in flight are finished; the sleeping workers are woken up to exit.
+ */
 static inline
-void ut_sort(
-	struct ut_s *test,
-	struct ut_group_config_s *config)
-{
-	// ut_dump_test(test);
-	qsort(test,
-		ut_get_total_test_count(test),
-		sizeof(struct ut_s),
-		ut_compare);
-	qsort(config,
-		ut_get_total_config_count(config),
-		sizeof(struct ut_group_config_s),
-		ut_compare);
-	// ut_dump_test(test);
-	// printf("%zu\n", ut_get_total_file_count(test));
+void ut_sched_check_failure(
+	struct ut_sched_s *sched,
+	struct ut_s const *test)
+{
+	if(sched->gconf->fail_fast == 0 || test->fail == 0) { return; }
+	if(__atomic_add_fetch(&sched->failed, 1, __ATOMIC_ACQ_REL) < sched->gconf->fail_fast) { return; }
+
+	pthread_mutex_lock(&sched->idle_lock);
+	__atomic_store_n(&sched->cancelled, 1, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&sched->idle_cond);
+	pthread_mutex_unlock(&sched->idle_lock);
 	return;
 }
 
+/**
+ * @fn ut_sched_drain
+ * @brief after a cancelled run: flush the messages held for the ordering, clean
+ * the group contexts left initialized, and unselect the tests not run
+ */
 static inline
-size_t *ut_build_file_index(
-	struct ut_s const *sorted_test)
+void ut_sched_drain(
+	struct ut_sched_s *sched)
 {
-	size_t cnt = 1;
-	utkvec_t(size_t) idx;
-	struct ut_s const *t = sorted_test;
-
-	utkv_init(idx);
-	if(t++->file == NULL) {
-		utkv_push(idx, 0);
-		utkv_push(idx, -1);
-		return(utkv_ptr(idx));
+	for(size_t i = sched->out_cursor; i < sched->test_cnt; i++) {
+		struct ut_out_s *o = &sched->out[i];
+		if(o->buf != NULL) { ut_out_write(sched->gconf->fp, o->buf, o->len); }
+		free(o->buf); o->buf = NULL;
 	}
+	sched->out_cursor = sched->test_cnt;
 
-	utkv_push(idx, 0);
-	while(t->file != NULL) {
-		// printf("comp %s and %s\n", (t - 1)->name, t->name);
-		if(ut_match((void *)(t - 1), (void *)t) != 0) {
-			utkv_push(idx, cnt);
+	for(size_t i = 0; i < sched->file_cnt; i++) {
+		struct ut_group_state_s *gs = &sched->gstate[i];
+		struct ut_group_config_s const *c = &sched->compd_config[i];
+		if(gs->initialized != 0 && c->init != NULL && c->clean != NULL) {
+			c->clean(gs->gctx);
 		}
-		cnt++;
-		t++;
+		gs->initialized = 0;
 	}
 
-	utkv_push(idx, cnt);
-	utkv_push(idx, -1);
-	return(utkv_ptr(idx));
+	for(size_t i = 0; i < sched->test_cnt; i++) {
+		if(sched->out[i].done == 0) { sched->test[i].exec = 0; }
+	}
+	return;
 }
 
-static inline
-struct ut_group_config_s *ut_compensate_config(
-	struct ut_s *sorted_test,
-	struct ut_group_config_s *sorted_config)
+/**
+ * @fn ut_sched_worker
+ */
+static
+void *ut_sched_worker(
+	void *arg)
 {
-	// printf("compensate config\n");
-	// ut_dump_test(sorted_test);
-	// ut_dump_config(sorted_config);
-
-	size_t *file_idx = ut_build_file_index(sorted_test);
-	utkvec_t(struct ut_group_config_s) compd_config;
-	utkv_init(compd_config);
-
-	size_t i = 0;
-	// printf("%zu\n", file_idx[i]);
-	struct ut_s const *t = &sorted_test[file_idx[i]];
-	struct ut_group_config_s const *c = sorted_config;
+	struct ut_worker_s *w = (struct ut_worker_s *)arg;
+	struct ut_sched_s *sched = w->sched;
+
+	while(__atomic_load_n(&sched->cancelled, __ATOMIC_ACQUIRE) == 0) {
+		size_t node_id;
+		if(ut_sched_pop(sched, w->id, &node_id)) {
+			struct ut_watch_s *wt = &sched->watch[w->id];
+			__atomic_store_n(&wt->start_ns, ut_now_ns(CLOCK_MONOTONIC), __ATOMIC_RELAXED);
+			__atomic_store_n(&wt->node_id, node_id, __ATOMIC_RELEASE);
+			ut_run_test(&sched->test[node_id], sched->gconf, sched->compd_config, sched->gstate);
+			__atomic_store_n(&wt->node_id, (size_t)-1, __ATOMIC_RELEASE);
+			ut_sched_check_failure(sched, &sched->test[node_id]);
+			ut_sched_emit(sched, node_id);
+			ut_sched_complete(sched, w->id, node_id);
+			continue;
+		}
 
-	while(c->file != NULL && t->file != NULL) {
-		while(ut_match((void *)t, (void *)c) != 0) {
-			// printf("filename does not match %s, %s\n", c->file, t->file);
-			utkv_push(compd_config, (struct ut_group_config_s){ .file = t->file });
-			t = &sorted_test[file_idx[++i]];
+		/* nothing to run; sleep until a node is pushed or everything is done */
+		pthread_mutex_lock(&sched->idle_lock);
+		while(sched->queued == 0 && __atomic_load_n(&sched->remaining, __ATOMIC_ACQUIRE) != 0
+		&& __atomic_load_n(&sched->cancelled, __ATOMIC_ACQUIRE) == 0) {
+			sched->sleeping++;
+			pthread_cond_wait(&sched->idle_cond, &sched->idle_lock);
+			sched->sleeping--;
 		}
-		// printf("matched %s, %s\n", c->file, t->file);
-		utkv_push(compd_config, *c);
-		c++;
-		t = &sorted_test[file_idx[++i]];
+		int done = sched->queued == 0 || sched->cancelled != 0;
+		pthread_mutex_unlock(&sched->idle_lock);
+		if(done) { break; }
 	}
-
-	free(file_idx);
-	return(utkv_ptr(compd_config));
+	utkv_destroy(ut_out_buf);
+	ut_dump_buf_destroy();
+	ut_arena_destroy(&ut_test_arena);
+	ut_catch_thread_destroy();
+	return(NULL);
 }
 
+/**
+ * @fn ut_sched_init
+ */
 static inline
-int ut_toposort_by_tag(
-	struct ut_s *sorted_test,
-	size_t test_cnt)
+void ut_sched_init(
+	struct ut_sched_s *sched,
+	struct ut_s *test,
+	size_t test_cnt,
+	struct ut_global_config_s const *gconf,
+	struct ut_group_config_s const *compd_config,
+	size_t const *file_idx,
+	size_t file_cnt,
+	size_t worker_cnt)
 {
-	/* init dag */
-	utkvec_t(utkvec_t(size_t)) dag;
-	utkv_init(dag);
-	utkv_reserve(dag, test_cnt);
-	for(size_t i = 0; i < test_cnt; i++) {
-		utkv_init(utkv_at(dag, i));
+	*sched = (struct ut_sched_s){
+		.test = test,
+		.gconf = gconf,
+		.compd_config = compd_config,
+		.file_cnt = file_cnt,
+		.gstate = ut_group_state_init(test, test_cnt, file_cnt),
+		.worker_cnt = worker_cnt
+	};
+	ut_sched_build_graph(sched, test, test_cnt, compd_config, file_idx, file_cnt);
+	ut_sched_build_rank(sched, gconf->history);
+	sched->remaining = sched->node_cnt;
+	pthread_mutex_init(&sched->idle_lock, NULL);
+	pthread_cond_init(&sched->idle_cond, NULL);
+	pthread_mutex_init(&sched->out_lock, NULL);
+	sched->out = (struct ut_out_s *)calloc(test_cnt + 1, sizeof(struct ut_out_s));
+	sched->watch = (struct ut_watch_s *)malloc(sizeof(struct ut_watch_s) * worker_cnt);
+	for(size_t i = 0; i < worker_cnt; i++) {
+		sched->watch[i] = (struct ut_watch_s){ .node_id = (size_t)-1 };
 	}
 
-	/* build dag */
-	for(size_t i = 0; i < test_cnt; i++) {
-		/* enumerate depends_on */
-		char const *const *d = sorted_test[i].depends_on;
-		while(*d != NULL) {
-			/* enumerate tests */
-			for(size_t j = 0; j < test_cnt; j++) {
-				if(i == j) { continue; }
-				if(ut_strcmp(sorted_test[j].name, *d) == 0) {
-					// printf("edge found from node %zu to node %zu\n", j, i);
-					utkv_push(utkv_at(dag, i), j);
-				}
-			}
-			d++;
-		}
+	sched->queue = (struct ut_queue_s *)calloc(sched->worker_cnt, sizeof(struct ut_queue_s));
+	for(size_t i = 0; i < sched->worker_cnt; i++) {
+		pthread_mutex_init(&sched->queue[i].lock, NULL);
+		sched->queue[i].heap = (size_t *)malloc(sizeof(size_t) * (test_cnt + 1));
 	}
 
-	/* build mark */
-	utkvec_t(int8_t) mark;
-	utkv_init(mark);
-	for(size_t i = 0; i < test_cnt; i++) {
-		// printf("incoming edge count %zu : %zu\n", i, utkv_size(utkv_at(dag, i)));
-		utkv_push(mark, utkv_size(utkv_at(dag, i)));
+	/* seed; empty groups (barriers without predecessors) are completed immediately */
+	utkvec_t(size_t) seed;
+	utkv_init(seed);
+	for(size_t i = 0; i < sched->node_cnt; i++) {
+		if(sched->pending[i] == 0) { utkv_push(seed, i); }
 	}
-
-	/* sort */
-	utkvec_t(struct ut_s) res;
-	utkv_init(res);
-	for(size_t i = 0; i < test_cnt; i++) {
-		size_t node_id = (size_t)-1LL;
-		for(size_t j = 0; j < test_cnt; j++) {
-			/* check if the node has incoming edges or is already pushed */
-			if(utkv_at(mark, j) == 0) {
-				node_id = j; break;
-			}
-		}
-
-		if(node_id == (size_t)-1LL) {
-			fprintf(stderr,
-				ut_color(UT_RED, "ERROR") ": detected circular dependency in the tests in `" ut_color(UT_MAGENTA, "%s") "'.\n",
-				sorted_test[0].file);
-			return(-1);
-		}
-
-		/* the node has no incoming edge */
-		// printf("the node %zu has no incoming edge\n", node_id);
-		utkv_push(res, sorted_test[node_id]);
-
-		/* mark pushed */
-		utkv_at(mark, node_id) = -1;
-
-		/* delete edges */
-		for(size_t j = 0; j < test_cnt; j++) {
-			if(node_id == j) { continue; }
-
-			for(size_t k = 0; k < utkv_size(utkv_at(dag, j)); k++) {
-				if(utkv_at(utkv_at(dag, j), k) == node_id) {
-					// printf("the node %zu had edge from %zu\n", j, node_id);
-					utkv_at(utkv_at(dag, j), k) = -1;
-					utkv_at(mark, j)--;
-					// printf("and then node %zu has %d incoming edges\n", j, utkv_at(mark, j));
-				}
-			}
+	for(size_t i = 0; i < utkv_size(seed); i++) {
+		if(utkv_at(seed, i) >= test_cnt) {
+			ut_sched_complete(sched, 0, utkv_at(seed, i));
+		} else {
+			ut_sched_push(sched, 0, utkv_at(seed, i));
 		}
 	}
+	utkv_destroy(seed);
+	return;
+}
 
-	if(utkv_size(res) != test_cnt) {
-		fprintf(stderr,
-			ut_color(UT_RED, "ERROR") ": detected circular dependency in the tests in `" ut_color(UT_MAGENTA, "%s") "'.\n",
-			sorted_test[0].file);
-		return(-1);
+/**
+ * @fn ut_sched_destroy
+ */
+static inline
+void ut_sched_destroy(
+	struct ut_sched_s *sched)
+{
+	for(size_t i = 0; i < sched->worker_cnt; i++) {
+		pthread_mutex_destroy(&sched->queue[i].lock);
+		free(sched->queue[i].heap);
 	}
-
-	/* write back */
-	for(size_t i = 0; i < test_cnt; i++) {
-		sorted_test[i] = utkv_at(res, i);
+	free(sched->queue);
+	free(sched->rank);
+	free(sched->order);
+	free(sched->watch);
+	for(size_t i = sched->out_cursor; i < sched->test_cnt; i++) {
+		free(sched->out[i].buf);
 	}
+	free(sched->out);
+	pthread_mutex_destroy(&sched->out_lock);
+	pthread_cond_destroy(&sched->idle_cond);
+	pthread_mutex_destroy(&sched->idle_lock);
+	ut_group_state_destroy(sched->gstate, sched->file_cnt);
+	ut_dag_destroy(&sched->dag);
+	return;
+}
 
-	/* cleanup */
+/**
+ * @fn ut_timeout_ms
+ * @brief effective timeout of the test: per-test, per-group, then the global default
+ */
+static inline
+size_t ut_timeout_ms(
+	struct ut_s const *test,
+	struct ut_group_config_s const *config,
+	struct ut_global_config_s const *gconf)
+{
+	if(test->timeout_ms != 0) { return(test->timeout_ms); }
+	if(config->timeout_ms != 0) { return(config->timeout_ms); }
+	return(gconf->timeout_ms);
+}
+
+static inline
+size_t ut_has_timeout(
+	struct ut_s const *test,
+	size_t test_cnt,
+	struct ut_group_config_s const *compd_config,
+	struct ut_global_config_s const *gconf)
+{
 	for(size_t i = 0; i < test_cnt; i++) {
-		utkv_destroy(utkv_at(dag, i));
+		if(test[i].exec != 0 && ut_timeout_ms(&test[i], &compd_config[test[i].index], gconf) != 0) { return(1); }
 	}
-	utkv_destroy(dag);
-	utkv_destroy(mark);
-	utkv_destroy(res);
-
 	return(0);
 }
 
+/**
+ * @fn ut_collect_results
+ * @brief per-group results of the tests, optionally only of those finished
+ */
 static inline
-int ut_toposort_by_group(
-	struct ut_s *sorted_test,
+struct ut_result_s *ut_collect_results(
+	struct ut_s const *test,
 	size_t test_cnt,
-	struct ut_group_config_s *sorted_config,
-	size_t *file_idx,
-	size_t file_cnt)
+	size_t file_cnt,
+	struct ut_out_s const *finished)
 {
-	/* init dag */
-	utkvec_t(utkvec_t(size_t)) dag;
-	utkv_init(dag);
-	utkv_reserve(dag, file_cnt);
-	for(size_t i = 0; i < file_cnt; i++) {
-		utkv_init(utkv_at(dag, i));
-	}
+	struct ut_result_s *res = (struct ut_result_s *)calloc(file_cnt + 1, sizeof(struct ut_result_s));
+	for(size_t i = 0; i < test_cnt; i++) {
+		if(test[i].exec == 0) { continue; }
+		if(finished != NULL && __atomic_load_n(&finished[i].done, __ATOMIC_ACQUIRE) == 0) { continue; }
 
-	/* build dag */
-	for(size_t i = 0; i < file_cnt; i++) {
-		/* enumerate depends_on */
-		char const *const *d = sorted_config[i].depends_on;
-		while(*d != NULL) {
-			/* enumerate tests */
-			for(size_t j = 0; j < file_cnt; j++) {
-				if(i == j) { continue; }
-				if(ut_strcmp(sorted_config[j].name, *d) == 0) {
-					// printf("edge found from group %zu to group %zu\n", j, i);
-					utkv_push(utkv_at(dag, i), j);
-				}
-			}
-			d++;
-		}
+		size_t index = test[i].index;
+		res[index].cnt++;
+		res[index].succ += test[i].succ;
+		res[index].fail += test[i].fail;
+		res[index].wall_ns += test[i].wall_ns;
+		res[index].cpu_ns += test[i].cpu_ns;
 	}
+	return(res);
+}
 
-	/* build mark */
-	utkvec_t(int8_t) mark;
-	utkv_init(mark);
-	for(size_t i = 0; i < file_cnt; i++) {
-		// printf("incoming edge count %zu : %zu\n", i, utkv_size(utkv_at(dag, i)));
-		utkv_push(mark, utkv_size(utkv_at(dag, i)));
+/**
+ * @fn ut_sched_timeout
+ * @brief report the stuck test, flush held messages and the partial summary, then abort
+ */
+static
+void ut_sched_timeout(
+	struct ut_sched_s *sched,
+	size_t node_id,
+	uint64_t elapsed_ns)
+{
+	struct ut_global_config_s const *gconf = sched->gconf;
+	struct ut_s const *t = &sched->test[node_id];
+
+	/* messages held for the ordering; tests still running have not published theirs */
+	pthread_mutex_lock(&sched->out_lock);
+	for(size_t i = sched->out_cursor; i < sched->test_cnt; i++) {
+		if(__atomic_load_n(&sched->out[i].done, __ATOMIC_ACQUIRE) == 0) { continue; }
+		ut_out_write(gconf->fp, sched->out[i].buf, sched->out[i].len);
 	}
 
-	/* sort */
-	utkvec_t(struct ut_s) test_buf;
-	utkvec_t(struct ut_group_config_s) config_buf;
-	utkv_init(test_buf);
-	utkv_init(config_buf);
-	// utkvec_t(size_t) res;
-	// utkv_init(res);
-	for(size_t i = 0; i < file_cnt; i++) {
-		size_t file_id = (size_t)-1LL;
-		for(size_t j = 0; j < file_cnt; j++) {
-			/* check if the node has incoming edges or is already pushed */
-			if(utkv_at(mark, j) == 0) {
-				file_id = j; break;
-			}
-		}
-
-		if(file_id == (size_t)-1LL) {
-			fprintf(stderr, ut_color(UT_RED, "ERROR") ": detected circular dependency between groups.\n");
-			return(-1);
-		}
-
-		/* the node has no incoming edge */
-		// printf("the node %zu has no incoming edge\n", file_id);
-		// utkv_push(res, file_id);
-
-		utkv_push(config_buf, sorted_config[file_id]);
-		for(size_t j = file_idx[file_id]; j < file_idx[file_id + 1]; j++) {
-			utkv_push(test_buf, sorted_test[j]);
-		}
+	gconf->printer.failed(t, gconf, &sched->compd_config[t->index], t->line, "", "(timeout)",
+		"test did not finish in %zu ms (running for %.1f ms), aborting",
+		ut_timeout_ms(t, &sched->compd_config[t->index], gconf),
+		(double)elapsed_ns / 1000000.0);
+	ut_out_flush(gconf);
+
+	/* partial summary of the finished tests */
+	struct ut_result_s *res = ut_collect_results(sched->test, sched->test_cnt, sched->file_cnt, sched->out);
+	gconf->printer.result(gconf, sched->compd_config, res, sched->file_cnt, sched->test, sched->test_cnt);
+	fflush(NULL);
+	abort();
+}
 
-		/* mark pushed */
-		utkv_at(mark, file_id) = -1;
+/**
+ * @fn ut_sched_watchdog
+ * @brief poll the tests in flight on the workers and abort on overrun
+ */
+static
+void *ut_sched_watchdog(
+	void *arg)
+{
+	struct ut_sched_s *sched = (struct ut_sched_s *)arg;
+	struct timespec const interval = { .tv_sec = 0, .tv_nsec = 5 * 1000000 };
 
-		/* delete edges */
-		for(size_t j = 0; j < file_cnt; j++) {
-			if(file_id == j) { continue; }
+	while(__atomic_load_n(&sched->remaining, __ATOMIC_ACQUIRE) != 0) {
+		nanosleep(&interval, NULL);
 
-			for(size_t k = 0; k < utkv_size(utkv_at(dag, j)); k++) {
-				if(utkv_at(utkv_at(dag, j), k) == file_id) {
-					// printf("the node %zu had edge from %zu\n", j, file_id);
-					utkv_at(utkv_at(dag, j), k) = -1;
-					utkv_at(mark, j)--;
-					// printf("and then node %zu has %d incoming edges\n", j, utkv_at(mark, j));
-				}
+		/* workers exit without completing the graph on cancellation */
+		size_t busy = 0;
+		for(size_t i = 0; i < sched->worker_cnt; i++) {
+			busy += __atomic_load_n(&sched->watch[i].node_id, __ATOMIC_ACQUIRE) != (size_t)-1;
+		}
+		if(busy == 0 && __atomic_load_n(&sched->cancelled, __ATOMIC_ACQUIRE) != 0) { break; }
+
+		uint64_t const now = ut_now_ns(CLOCK_MONOTONIC);
+		for(size_t i = 0; i < sched->worker_cnt; i++) {
+			size_t node_id = __atomic_load_n(&sched->watch[i].node_id, __ATOMIC_ACQUIRE);
+			uint64_t start = __atomic_load_n(&sched->watch[i].start_ns, __ATOMIC_RELAXED);
+			if(node_id == (size_t)-1 || now < start) { continue; }
+
+			struct ut_s const *t = &sched->test[node_id];
+			size_t const limit = ut_timeout_ms(t, &sched->compd_config[t->index], sched->gconf);
+			if(limit != 0 && now - start > (uint64_t)limit * 1000000ULL) {
+				ut_sched_timeout(sched, node_id, now - start);
 			}
 		}
 	}
+	return(NULL);
+}
 
-	if(utkv_size(config_buf) != file_cnt) {
-		fprintf(stderr, ut_color(UT_RED, "ERROR") ": detected circular dependency between groups.\n");
-		return(-1);
-	}
-
-	/* write back */
-	for(size_t i = 0; i < test_cnt; i++) {
-		sorted_test[i] = utkv_at(test_buf, i);
+/**
+ * @fn ut_sched_run
+ * @brief run tests on a work-stealing pool; a test is released when all its
+ * test-level and group-level predecessors are completed. the calling thread
+ * works as the first worker, so no thread is created when threads <= 1.
+ */
+static
+void ut_sched_run(
+	struct ut_s *test,
+	size_t test_cnt,
+	struct ut_global_config_s const *gconf,
+	struct ut_group_config_s const *compd_config,
+	size_t const *file_idx,
+	size_t file_cnt)
+{
+	struct ut_sched_s sched;
+	ut_sched_init(&sched, test, test_cnt, gconf, compd_config, file_idx, file_cnt,
+		gconf->threads > 1 ? gconf->threads : 1);
+
+	/* run */
+	struct ut_worker_s *w = (struct ut_worker_s *)calloc(sched.worker_cnt, sizeof(struct ut_worker_s));
+	for(size_t i = 0; i < sched.worker_cnt; i++) {
+		w[i] = (struct ut_worker_s){ .sched = &sched, .id = i };
 	}
-	for(size_t i = 0; i < file_cnt; i++) {
-		sorted_config[i] = utkv_at(config_buf, i);
+	for(size_t i = 1; i < sched.worker_cnt; i++) {
+		pthread_create(&w[i].th, NULL, ut_sched_worker, (void *)&w[i]);
 	}
 
-	/* cleanup */
-	for(size_t i = 0; i < file_cnt; i++) {
-		utkv_destroy(utkv_at(dag, i));
+	pthread_t watchdog;
+	int const watched = ut_has_timeout(test, test_cnt, compd_config, gconf)
+		&& pthread_create(&watchdog, NULL, ut_sched_watchdog, (void *)&sched) == 0;
+
+	ut_sched_worker((void *)&w[0]);
+	for(size_t i = 1; i < sched.worker_cnt; i++) {
+		pthread_join(w[i].th, NULL);
 	}
-	utkv_destroy(dag);
-	utkv_destroy(mark);
-	utkv_destroy(test_buf);
-	utkv_destroy(config_buf);
+	if(watched) { pthread_join(watchdog, NULL); }
+	if(sched.cancelled != 0) { ut_sched_drain(&sched); }
 
-	return(0);
+	/* cleanup */
+	free(w);
+	ut_sched_destroy(&sched);
+	return;
 }
 
 /**
- * @fn ut_build_short_option_string
- * @brief build short getopt string (i.e. "a:b:vVQ") from an array of struct option
+ * @struct ut_slot_s
+ * @brief per-test result in the shared-memory result table (--isolate)
  */
-static inline
-char *ut_build_short_option_string(struct option const *opts)
+struct ut_slot_s {
+	size_t succ, fail;
+	uint64_t wall_ns, cpu_ns;
+	size_t msg_pos, msg_len;	/* failure messages in the shared arena */
+};
+
+#ifndef UNITTEST_ISOLATE_ARENA_SIZE
+#define UNITTEST_ISOLATE_ARENA_SIZE		( 64ULL * 1024 * 1024 )
+#endif
+
+/**
+ * @struct ut_isolate_s
+ * @brief shared-memory result table and message arena, mapped before forking workers
+ */
+struct ut_isolate_s {
+	struct ut_slot_s *slot;
+	size_t map_size;
+	size_t *arena_used;
+	char *arena;
+	size_t arena_size;
+};
+
+/**
+ * @struct ut_proc_s
+ * @brief forked worker; receives test indices on cmd_fd and reports them back on done_fd
+ */
+struct ut_proc_s {
+	pid_t pid;
+	int cmd_fd, done_fd;
+	size_t node_id;			/* test in flight, (size_t)-1 when idle */
+	uint64_t deadline_ns;	/* 0 when the test has no timeout */
+	int timed_out;			/* killed by the runner */
+};
+
+/**
+ * @fn ut_isolate_child
+ * @brief worker loop; runs until the command pipe is closed
+ */
+static
+void ut_isolate_child(
+	struct ut_sched_s *sched,
+	struct ut_isolate_s *iso,
+	int cmd_fd,
+	int done_fd)
 {
-	char *str = NULL, *ps;
-	size_t len = 0;
-	struct option const *po = NULL;
+	size_t node_id;
+	while(read(cmd_fd, &node_id, sizeof(size_t)) == (ssize_t)sizeof(size_t)) {
+		struct ut_s *t = &sched->test[node_id];
+		ut_run_test(t, sched->gconf, sched->compd_config, sched->gstate);
+
+		/* publish results; messages are appended to the shared arena */
+		struct ut_slot_s *slot = &iso->slot[node_id];
+		size_t len = utkv_size(ut_out_buf);
+		size_t pos = __atomic_fetch_add(iso->arena_used, len, __ATOMIC_RELAXED);
+		if(pos + len > iso->arena_size) {
+			len = pos < iso->arena_size ? iso->arena_size - pos : 0;
+		}
+		if(len > 0) { memcpy(&iso->arena[pos], utkv_ptr(ut_out_buf), len); }
+		utkv_clear(ut_out_buf);
+
+		*slot = (struct ut_slot_s){
+			.succ = t->succ, .fail = t->fail,
+			.wall_ns = t->wall_ns, .cpu_ns = t->cpu_ns,
+			.msg_pos = pos, .msg_len = len
+		};
+		if(write(done_fd, &node_id, sizeof(size_t)) != (ssize_t)sizeof(size_t)) { break; }
+	}
 
-	for(po = opts; po->name != NULL; po++) { len++; }
-	str = ps = (char *)malloc(2 * len + 1);
-	for(po = opts; po->name != NULL; po++) {
-		*ps++ = (char)po->val;
-		if(po->has_arg != no_argument) {
-			*ps++ = ':';
+	/* tear down the group contexts created in this process */
+	for(size_t i = 0; i < sched->file_cnt; i++) {
+		struct ut_group_config_s const *c = &sched->compd_config[i];
+		if(sched->gstate[i].initialized != 0 && c->init != NULL && c->clean != NULL) {
+			c->clean(sched->gstate[i].gctx);
 		}
 	}
-	*ps = '\0';
-	return(str);
+	fflush(NULL);
+	_exit(0);
 }
 
 /**
- * @fn ut_modify_test_config_mark
+ * @fn ut_isolate_spawn
  */
 static inline
-int ut_modify_test_config_mark(
-	char const *arg,
-	void *_test,
-	size_t cnt)
+int ut_isolate_spawn(
+	struct ut_sched_s *sched,
+	struct ut_isolate_s *iso,
+	struct ut_proc_s *procs,
+	size_t proc_cnt,
+	size_t id)
 {
-	struct ut_s *test = (struct ut_s *)_test;
-	char const *p = arg, *b = arg;
-	while(*p != '\0') {
-		/* parse with comma */
-		while(*p != '\0' && *p != ',') { p++; }
-
-		/* copy string */
-		char buf[p - b + 1];
-		memcpy(buf, b, p - b);
-		buf[p - b] = '\0';
-
-		/* linear search among tests */
-		int marked = 0;
-		for(size_t i = 0; i < cnt; i++) {
-			if(ut_strcmp(test[i].name, buf) == 0) {
-				test[i].exec = 2; marked = 1;
-			} else {
-				test[i].exec = 0;
-			}
-		}
-		if(marked == 0) {
-			fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": group `%s' not found.\n", buf);
+	int cmd[2], done[2];
+	if(pipe(cmd) != 0) { return(-1); }
+	if(pipe(done) != 0) { close(cmd[0]); close(cmd[1]); return(-1); }
+
+	fflush(NULL);
+	pid_t pid = fork();
+	if(pid < 0) {
+		close(cmd[0]); close(cmd[1]); close(done[0]); close(done[1]);
+		return(-1);
+	}
+	if(pid == 0) {
+		/* close the ends held by the parent and the other workers */
+		close(cmd[1]); close(done[0]);
+		for(size_t i = 0; i < proc_cnt; i++) {
+			if(i == id || procs[i].pid <= 0) { continue; }
+			close(procs[i].cmd_fd); close(procs[i].done_fd);
 		}
-
-		if(*p == '\0') { break; }
-		b = ++p;
+		ut_isolate_child(sched, iso, cmd[0], done[1]);
 	}
+
+	close(cmd[0]); close(done[1]);
+	procs[id] = (struct ut_proc_s){
+		.pid = pid,
+		.cmd_fd = cmd[1],
+		.done_fd = done[0],
+		.node_id = (size_t)-1
+	};
 	return(0);
 }
 
 /**
- * @fn ut_modify_test_config_all
+ * @fn ut_isolate_finish
+ * @brief collect the result of a test from the shared table, then release its successors
  */
 static inline
-int ut_modify_test_config_all(
-	void *_test,
-	size_t cnt)
+void ut_isolate_finish(
+	struct ut_sched_s *sched,
+	struct ut_isolate_s *iso,
+	size_t node_id)
 {
-	struct ut_s *test = (struct ut_s *)_test;
-	for(size_t i = 0; i < cnt; i++) {
-		test[i].exec = 1;
+	struct ut_s *t = &sched->test[node_id];
+	struct ut_slot_s const *slot = &iso->slot[node_id];
+
+	t->succ = slot->succ;
+	t->fail = slot->fail;
+	t->wall_ns = slot->wall_ns;
+	t->cpu_ns = slot->cpu_ns;
+	if(slot->msg_len != 0) {
+		ut_out_printf("%.*s", (int)slot->msg_len, &iso->arena[slot->msg_pos]);
 	}
-	return(0);
+	ut_sched_check_failure(sched, t);
+	ut_sched_emit(sched, node_id);
+	ut_sched_complete(sched, 0, node_id);
+	return;
 }
 
 /**
- * @fn ut_print_help
+ * @fn ut_isolate_crashed
+ * @brief record the test in flight as failed and fork a replacement
  */
 static inline
-void ut_print_help(void)
+void ut_isolate_crashed(
+	struct ut_sched_s *sched,
+	struct ut_isolate_s *iso,
+	struct ut_proc_s *procs,
+	size_t proc_cnt,
+	size_t id)
 {
-	static char const *help_message =
-		"\n"
-		"  unittest.h -- simple unittesting framework for C99\n"
-		"\n"
-		"  Options:\n"
-		"    -g, --group   [STR,...]  specify group names\n"
-		"    -t, --test    [STR,...]  specify test names\n"
-		"    -s, --seed    [INT       invoke libc::srand with the seed\n"
-		"    -o, --stdout             redirect to stdout\n"
-		"    -j, --json               print result in json\n"
-		"    -n, --threads [INT]      number of threads\n"
-		"    -h, --help               show this message\n"
-		"\n"
-		"  this is an auto-generated message from unittest.h\n"
-		"  the latest source is available at:\n"
-		"    https://github.com/ocxtal/unittest.h\n"
-		"\n";
+	struct ut_proc_s *p = &procs[id];
+	int status = 0;
+	close(p->cmd_fd);
+	close(p->done_fd);
+	waitpid(p->pid, &status, 0);
+	p->pid = 0;
+
+	size_t node_id = p->node_id;
+	if(node_id != (size_t)-1) {
+		struct ut_s *t = &sched->test[node_id];
+		struct ut_group_config_s const *c = &sched->compd_config[t->index];
+		iso->slot[node_id] = (struct ut_slot_s){ .succ = 0, .fail = 1 };
+		if(p->timed_out) {
+			sched->gconf->printer.failed(t, sched->gconf, c, t->line, "", "(timeout)",
+				"test did not finish in %zu ms, worker killed", ut_timeout_ms(t, c, sched->gconf));
+		} else if(WIFSIGNALED(status)) {
+			sched->gconf->printer.failed(t, sched->gconf, c, t->line, "", "(crashed)",
+				"worker terminated by %s", ut_signal_name(WTERMSIG(status)));
+		} else {
+			sched->gconf->printer.failed(t, sched->gconf, c, t->line, "", "(crashed)",
+				"worker exited with status %d", WEXITSTATUS(status));
+		}
+		ut_isolate_finish(sched, iso, node_id);
+	}
 
-	fprintf(stderr, "%s", help_message);
+	if(ut_isolate_spawn(sched, iso, procs, proc_cnt, id) != 0) {
+		fprintf(stderr, ut_color(UT_RED, "ERROR") ": failed to fork a worker.\n");
+	}
 	return;
 }
 
 /**
- * @fn ut_modify_test_config
+ * @fn ut_isolate_run
+ * @brief run tests on a pool of pre-forked workers (--isolate). a worker is
+ * reused across tests until it crashes, and replaced only then; results travel
+ * back through a shared-memory table, so a crash costs only the test in flight.
  */
-static inline
-int ut_modify_test_config(
-	int argc,
-	char *const argv[],
-	struct ut_global_config_s *params,
-	struct ut_s *sorted_test,
+static
+int ut_isolate_run(
+	struct ut_s *test,
 	size_t test_cnt,
-	struct ut_group_config_s *sorted_config,
+	struct ut_global_config_s const *gconf,
+	struct ut_group_config_s const *compd_config,
+	size_t const *file_idx,
 	size_t file_cnt)
 {
-	static struct option const opts_long[] = {
-		{ "group", required_argument, NULL, 'g' },
-		{ "test", required_argument, NULL, 't' },
-		{ "seed", required_argument, NULL, 's' },
-		{ "stdout", no_argument, NULL, 'o' },
-		{ "json", no_argument, NULL, 'j' },
-		{ "threads", required_argument, NULL, 'n' },
-		{ "help", no_argument, NULL, 'h' },
-		{ NULL, 0, NULL, 0 }
-	};
-	char *opts_short = ut_build_short_option_string(opts_long);
-
-	int c, idx;
-	char const *group_arg = NULL, *test_arg = NULL;
-	while((c = getopt_long(argc, argv, opts_short, opts_long, &idx)) != -1) {
-		switch(c) {
-			case 'g': group_arg = optarg; break;
-			case 't': test_arg = optarg; break;
-			case 's': srand((unsigned int)atol(optarg)); break;
-			case 'j': params->printer = ut_json_printer; break;
-			case 'o': params->fp = stdout; break;
-			case 'n': params->threads = atoi(optarg); break;
-			case 'h': ut_print_help(); return(1);
-			default: break;
+	/* shared result table and message arena */
+	struct ut_isolate_s iso;
+	size_t const table_size = (sizeof(struct ut_slot_s) * (test_cnt + 1) + 4095) & ~(size_t)4095;
+	iso.arena_size = UNITTEST_ISOLATE_ARENA_SIZE;
+	iso.map_size = table_size + sizeof(size_t) + iso.arena_size;
+
+	void *base = ut_mmap_anon(iso.map_size, MAP_SHARED | MAP_NORESERVE);
+	if(base == MAP_FAILED) {
+		fprintf(stderr, ut_color(UT_RED, "ERROR") ": failed to map the shared result table.\n");
+		return(-1);
+	}
+	iso.slot = (struct ut_slot_s *)base;
+	iso.arena_used = (size_t *)((uint8_t *)base + table_size);
+	iso.arena = (char *)(iso.arena_used + 1);
+
+	struct ut_sched_s sched;
+	ut_sched_init(&sched, test, test_cnt, gconf, compd_config, file_idx, file_cnt, 1);
+
+	/* workers die with EPIPE rather than killing the runner */
+	void (*sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+	size_t const proc_cnt = gconf->threads > 1 ? gconf->threads : 1;
+	struct ut_proc_s *procs = (struct ut_proc_s *)calloc(proc_cnt, sizeof(struct ut_proc_s));
+	struct pollfd *pfd = (struct pollfd *)calloc(proc_cnt, sizeof(struct pollfd));
+	for(size_t i = 0; i < proc_cnt; i++) {
+		if(ut_isolate_spawn(&sched, &iso, procs, proc_cnt, i) != 0) {
+			fprintf(stderr, ut_color(UT_RED, "ERROR") ": failed to fork a worker.\n");
+			break;
 		}
 	}
 
-	if(group_arg != NULL) {
-		ut_modify_test_config_mark(group_arg, (void *)sorted_config, file_cnt);
-	} else {
-		ut_modify_test_config_all((void *)sorted_config, file_cnt);
+	while(sched.remaining != 0) {
+		/* dispatch ready tests to idle workers; unselected ones are completed here */
+		size_t busy = 0, alive = 0;
+		for(size_t i = 0; i < proc_cnt; i++) {
+			struct ut_proc_s *p = &procs[i];
+			size_t node_id;
+			while(p->pid > 0 && p->node_id == (size_t)-1 && sched.cancelled == 0 && ut_sched_pop(&sched, 0, &node_id)) {
+				if(test[node_id].exec == 0) {
+					ut_sched_complete(&sched, 0, node_id);
+					continue;
+				}
+				size_t const limit = ut_timeout_ms(&test[node_id], &compd_config[test[node_id].index], gconf);
+				p->node_id = node_id;
+				p->deadline_ns = limit == 0 ? 0 : ut_now_ns(CLOCK_MONOTONIC) + (uint64_t)limit * 1000000ULL;
+				if(write(p->cmd_fd, &node_id, sizeof(size_t)) != (ssize_t)sizeof(size_t)) {
+					ut_isolate_crashed(&sched, &iso, procs, proc_cnt, i);
+				}
+			}
+			busy += p->pid > 0 && p->node_id != (size_t)-1;
+			alive += p->pid > 0;
+		}
+		if(busy == 0) {
+			if(sched.remaining == 0 || sched.cancelled != 0) { break; }
+			if(alive == 0 || sched.queued == 0) {
+				fprintf(stderr, ut_color(UT_RED, "ERROR") ": no worker available.\n");
+				break;
+			}
+			continue;
+		}
+
+		/* wait for completion, crash, or the earliest deadline */
+		uint64_t deadline = UINT64_MAX;
+		for(size_t i = 0; i < proc_cnt; i++) {
+			int const running = procs[i].pid > 0 && procs[i].node_id != (size_t)-1;
+			pfd[i] = (struct pollfd){
+				.fd = running ? procs[i].done_fd : -1,
+				.events = POLLIN
+			};
+			if(running && procs[i].deadline_ns != 0 && procs[i].deadline_ns < deadline) {
+				deadline = procs[i].deadline_ns;
+			}
+		}
+		uint64_t const now = ut_now_ns(CLOCK_MONOTONIC);
+		int const wait_ms = deadline == UINT64_MAX ? -1 : (deadline <= now ? 0 : (int)((deadline - now) / 1000000ULL) + 1);
+		int const ready = poll(pfd, proc_cnt, wait_ms);
+		if(ready < 0) {
+			if(errno == EINTR) { continue; }
+			break;
+		}
+
+		/* kill overrunning workers; they are replaced in the crash path */
+		for(size_t i = 0; i < proc_cnt && deadline != UINT64_MAX; i++) {
+			if(pfd[i].fd < 0 || pfd[i].revents != 0 || procs[i].deadline_ns == 0) { continue; }
+			if(ut_now_ns(CLOCK_MONOTONIC) < procs[i].deadline_ns) { continue; }
+			kill(procs[i].pid, SIGKILL);
+			procs[i].timed_out = 1;
+			pfd[i].revents = POLLHUP;
+		}
+		for(size_t i = 0; i < proc_cnt; i++) {
+			if(pfd[i].fd < 0 || pfd[i].revents == 0) { continue; }
+
+			size_t node_id;
+			if((pfd[i].revents & POLLIN) && read(procs[i].done_fd, &node_id, sizeof(size_t)) == (ssize_t)sizeof(size_t)) {
+				procs[i].node_id = (size_t)-1;
+				ut_isolate_finish(&sched, &iso, node_id);
+			} else {
+				ut_isolate_crashed(&sched, &iso, procs, proc_cnt, i);
+			}
+		}
 	}
 
-	if(test_arg != NULL) {
-		ut_modify_test_config_mark(test_arg, (void *)sorted_test, test_cnt);
-	} else {
-		ut_modify_test_config_all((void *)sorted_test, test_cnt);
+	/* shut down workers */
+	for(size_t i = 0; i < proc_cnt; i++) {
+		if(procs[i].pid <= 0) { continue; }
+		close(procs[i].cmd_fd);
+		close(procs[i].done_fd);
+		waitpid(procs[i].pid, NULL, 0);
 	}
+	signal(SIGPIPE, sigpipe);
+	if(sched.cancelled != 0) { ut_sched_drain(&sched); }
 
-	free(opts_short);
+	free(pfd);
+	free(procs);
+	ut_sched_destroy(&sched);
+	munmap(base, iso.map_size);
 	return(0);
 }
 
 /**
- * @fn ut_propagate_config
+ * @enum ut_phase_e
+ * @brief phases of the runner, timed for --profile
  */
-static inline
-void ut_propagate_config(
-	struct ut_s *test,
-	size_t test_cnt,
-	struct ut_group_config_s *compd_config,
-	size_t *sorted_file_idx,
-	size_t file_cnt)
-{
-	ut_unused(test_cnt);
-	ut_unused(compd_config);
-
-	/* set index */
-	for(size_t i = 0; i < file_cnt; i++) {
-		for(size_t j = sorted_file_idx[i]; j < sorted_file_idx[i + 1]; j++) {
-			test[j].index = i;
-			test[j].succ = 0;		/* clear counters */
-			test[j].fail = 0;
-		}
-	}
-	return;
-}
+enum ut_phase_e {
+	UT_PHASE_DISCOVER = 0,	/* collect tests and configs */
+	UT_PHASE_SORT,			/* sort by group, tag, line */
+	UT_PHASE_TOPOSORT,
+	UT_PHASE_SETUP,			/* options, history, sharding, change detection */
+	UT_PHASE_RUN,
+	UT_PHASE_COLLECT,		/* per-group results and record files */
+	UT_PHASE_PRINT,
+	UT_PHASE_CNT
+};
 
 /**
- * @fn ut_run_test
+ * @fn ut_save_profile
+ * @brief write the phase timings (stamp[i] .. stamp[i + 1] for phase i) and the counts in json
  */
-static
-void ut_run_test(
-	struct ut_s *test,
+static inline
+int ut_save_profile(
+	char const *filename,
+	uint64_t const *stamp,
 	struct ut_global_config_s const *gconf,
-	struct ut_group_config_s const *compd_config)
+	struct ut_s const *test,
+	size_t test_cnt,
+	size_t file_cnt)
 {
-	if(test->exec == 0) { return; }
-	size_t index = test->index;
+	static char const *const names[UT_PHASE_CNT] = {
+		"discover", "sort", "toposort", "setup", "run", "collect", "print"
+	};
 
-	/* initialize group context */
-	void *gctx = NULL;
-	if(compd_config[index].init != NULL && compd_config[index].clean != NULL) {
-		gctx = compd_config[index].init(compd_config[index].params);
+	FILE *fp = fopen(filename, "w");
+	if(fp == NULL) {
+		fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": failed to open `%s'.\n", filename);
+		return(-1);
 	}
 
-	/* initialize local context */
-	void *ctx = NULL;
-	if(test->init != NULL && test->clean != NULL) {
-		ctx = test->init(test->params);
+	size_t run = 0, succ = 0, fail = 0;
+	uint64_t wall_ns = 0, cpu_ns = 0;
+	for(size_t i = 0; i < test_cnt; i++) {
+		if(test[i].exec == 0) { continue; }
+		run++;
+		succ += test[i].succ;
+		fail += test[i].fail;
+		wall_ns += test[i].wall_ns;
+		cpu_ns += test[i].cpu_ns;
 	}
 
-	/* run a test */
-	test->fn(ctx, gctx, test, gconf, &compd_config[index]);
-
-	/* cleanup contexts */
-	if(test->init != NULL && test->clean != NULL) {
-		test->clean(ctx);
+	fprintf(fp, "{\"tests\": %zu, \"groups\": %zu, \"executed\": %zu, \"threads\": %zu, ",
+		test_cnt, file_cnt, run, gconf->threads > 1 ? gconf->threads : 1);
+	fprintf(fp, "\"isolate\": %zu, \"succeeded\": %zu, \"failed\": %zu, ", gconf->isolate, succ, fail);
+	fprintf(fp, "\"test_wall_ns\": %" PRIu64 ", \"test_cpu_ns\": %" PRIu64 ", \"phases_ns\": {", wall_ns, cpu_ns);
+	for(size_t i = 0; i < UT_PHASE_CNT; i++) {
+		fprintf(fp, "%s\"%s\": %" PRIu64, i == 0 ? "" : ", ", names[i], stamp[i + 1] - stamp[i]);
 	}
-	if(compd_config[index].init != NULL && compd_config[index].clean != NULL) {
-		compd_config[index].clean(gctx);
+	fprintf(fp, "}, \"total_ns\": %" PRIu64 "}\n", stamp[UT_PHASE_CNT] - stamp[0]);
+
+	if(fclose(fp) != 0) {
+		fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": failed to write `%s'.\n", filename);
+		return(-1);
 	}
-	return;
+	return(0);
 }
 
 /**
@@ -1460,19 +6181,35 @@ void ut_run_test(
 static
 int ut_main_impl(int argc, char *argv[])
 {
+	uint64_t stamp[UT_PHASE_CNT + 1];
+	stamp[UT_PHASE_DISCOVER] = ut_now_ns(CLOCK_MONOTONIC);
+
+	/* collect tests and configs */
+	struct ut_registry_s reg;
+	#if UNITTEST_USE_SECTION != 0
+	ut_get_registry_section(&reg);
+	#else
 	/* dump symbol table */
-	struct ut_nm_result_s *nm = ut_nm(argv[0]);
+	struct ut_nm_s *nm = ut_nm(argv[0]);
 
 	if(nm == NULL) {
 		return(1);
 	}
-
-	/* dump tests and configs */
-	struct ut_s *test = ut_get_unittest(nm);
-	struct ut_group_config_s *config = ut_get_ut_config(nm);
+	ut_get_registry(nm, &reg);
+	ut_nm_clean(nm);
+	#endif
 
 	/* sort by group, tag, line */
-	ut_sort(test, config);
+	stamp[UT_PHASE_SORT] = ut_now_ns(CLOCK_MONOTONIC);
+	uint32_t *test_perm = ut_sort_perm((void const *const *)reg.test, reg.test_cnt, ut_compare);
+	uint32_t *config_perm = ut_sort_perm((void const *const *)reg.config, reg.config_cnt, ut_compare);
+	struct ut_s *test = (struct ut_s *)ut_gather(reg.test, 0, test_perm, reg.test_cnt, sizeof(struct ut_s));
+	struct ut_group_config_s *config = (struct ut_group_config_s *)ut_gather(reg.config, 0,
+		config_perm, reg.config_cnt, sizeof(struct ut_group_config_s));
+	free(test_perm);
+	free(config_perm);
+	ut_registry_destroy(&reg);
+
 	struct ut_group_config_s *compd_config = ut_compensate_config(test, config);
 
 	size_t test_cnt = ut_get_total_test_count(test);
@@ -1481,24 +6218,15 @@ int ut_main_impl(int argc, char *argv[])
 
 	// printf("%zu\n", file_cnt);
 
-	/* topological sort by tag */
-	for(size_t i = 0; i < file_cnt; i++) {
-		// printf("toposort %zu, %zu\n", file_idx[i], file_idx[i + 1]);
-		if(ut_toposort_by_tag(&test[file_idx[i]], file_idx[i + 1] - file_idx[i]) != 0) {
-			fprintf(stderr, ut_color(UT_RED, "ERROR") ": failed to order tests. check if the depends_on options are sane.\n");
-			return(1);
-		}
-	}
-
-	// ut_dump_test(test);
-
-	/* topological sort by group */
-	if(ut_toposort_by_group(test, test_cnt, compd_config, file_idx, file_cnt) != 0) {
+	/* topological sort by tag, then by group */
+	stamp[UT_PHASE_TOPOSORT] = ut_now_ns(CLOCK_MONOTONIC);
+	if(ut_toposort(&test, test_cnt, compd_config, file_idx, file_cnt) != 0) {
 		fprintf(stderr, ut_color(UT_RED, "ERROR") ": failed to order tests. check if the depends_on options are sane.\n");
 		return(1);
 	}
 
 	/* rebuild file idx */
+	stamp[UT_PHASE_SETUP] = ut_now_ns(CLOCK_MONOTONIC);
 	size_t *sorted_file_idx = ut_build_file_index(test);
 
 	/* init default params */
@@ -1515,34 +6243,89 @@ int ut_main_impl(int argc, char *argv[])
 	/* copy exec flag */
 	ut_propagate_config(test, test_cnt, compd_config, sorted_file_idx, file_cnt);
 
+	/* load history */
+	struct ut_record_s *history = NULL;
+	if(gconf.history_file != NULL) {
+		gconf.history = history = ut_load_records(gconf.history_file, test, test_cnt);
+	}
+
+	/* split into shards */
+	if(gconf.shard_count > 1) {
+		struct ut_record_s *rec = gconf.timing_file == NULL ? NULL : ut_load_records(gconf.timing_file, test, test_cnt);
+		ut_shard_tests(test, test_cnt, &gconf, rec != NULL ? rec : history, sorted_file_idx, file_cnt);
+		free(rec);
+	}
+
+	/* skip the tests unchanged since they passed */
+	uint64_t *prev_hash = NULL, *curr_hash = NULL;
+	char *cache_buf = NULL;
+	char const *cache_file = gconf.cache_file;
+	if(gconf.changed_only != 0) {
+		if(cache_file == NULL) { cache_file = cache_buf = ut_default_cache_file(argv[0]); }
+		if((curr_hash = ut_hash_tests(argv[0], test, test_cnt, compd_config)) == NULL) {
+			fprintf(stderr, ut_color(UT_YELLOW, "Warning") ": failed to locate the code of the tests; running all.\n");
+		} else {
+			prev_hash = ut_load_hash_cache(cache_file, test, test_cnt);
+			size_t skipped = ut_select_changed(test, test_cnt, compd_config, prev_hash, curr_hash, sorted_file_idx, file_cnt);
+			if(skipped != 0) {
+				fprintf(stderr, "%zu unchanged test%s skipped.\n", skipped, skipped == 1 ? "" : "s");
+			}
+		}
+	}
+
 	/* run tests */
-	#ifdef _OPENMP
-	omp_set_num_threads(gconf.threads);
-	#pragma omp parallel for
-	#endif
-	for(size_t i = 0; i < test_cnt; i++) {
-		ut_run_test(&test[i], &gconf, compd_config);
+	stamp[UT_PHASE_RUN] = ut_now_ns(CLOCK_MONOTONIC);
+	size_t selected = 0;
+	for(size_t i = 0; i < test_cnt; i++) { selected += test[i].exec != 0; }
+	if(gconf.catch_signals != 0) {
+		ut_catch_install();
+	}
+	if(gconf.isolate != 0) {
+		ut_isolate_run(test, test_cnt, &gconf, compd_config, sorted_file_idx, file_cnt);
+	} else {
+		ut_sched_run(test, test_cnt, &gconf, compd_config, sorted_file_idx, file_cnt);
+	}
+
+	/* tests not started after fail-fast triggered */
+	size_t run = 0;
+	for(size_t i = 0; i < test_cnt; i++) { run += test[i].exec != 0; }
+	if(run != selected) {
+		fprintf(stderr, "%zu test%s skipped by --fail-fast.\n", selected - run, selected - run == 1 ? "" : "s");
 	}
 
 	/* collect results */
-	struct ut_result_s *res = calloc(sizeof(struct ut_result_s), file_cnt);
-	for(size_t i = 0; i < test_cnt; i++) {
-		size_t index = test[i].index;
-		res[index].cnt++;
-		res[index].succ += test[i].succ;
-		res[index].fail += test[i].fail;
+	stamp[UT_PHASE_COLLECT] = ut_now_ns(CLOCK_MONOTONIC);
+	struct ut_result_s *res = ut_collect_results(test, test_cnt, file_cnt, NULL);
+	if(gconf.save_timing_file != NULL) {
+		ut_save_records(gconf.save_timing_file, test, test_cnt, NULL);
+	}
+	if(gconf.history_file != NULL) {
+		ut_save_records(gconf.history_file, test, test_cnt, history);
+	}
+	if(curr_hash != NULL) {
+		ut_save_hash_cache(cache_file, test, test_cnt, prev_hash, curr_hash);
 	}
 
 	/* print results */
-	gconf.printer.result(&gconf, compd_config, res, file_cnt);
+	stamp[UT_PHASE_PRINT] = ut_now_ns(CLOCK_MONOTONIC);
+	gconf.printer.result(&gconf, compd_config, res, file_cnt, test, test_cnt);
+	fflush(gconf.fp);
+
+	stamp[UT_PHASE_CNT] = ut_now_ns(CLOCK_MONOTONIC);
+	if(gconf.profile_file != NULL) {
+		ut_save_profile(gconf.profile_file, stamp, &gconf, test, test_cnt, file_cnt);
+	}
 
+	free(prev_hash);
+	free(curr_hash);
+	free(cache_buf);
+	free(history);
 	free(res);
 	free(sorted_file_idx);
 	free(file_idx);
 	free(compd_config);
 	free(test);
 	free(config);
-	free(nm);
 	return(0);
 }
 